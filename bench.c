@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "miner.h"
+
+// Benchmarks the phases of a miner on synthetic logs.
+// Build: make tools, which puts it in build/bench
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define DEFAULT_CASES 100000
+#define DEFAULT_VARIANTS 200
+#define DEFAULT_ALPHABET 20
+#define DEFAULT_LENGTH 12
+#define DEFAULT_REPS 3
+#define DEFAULT_SEED 1
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct
+{                  // the shape of a synthetic log
+    int cases;     // the number of traces
+    int variants;  // the number of distinct traces to draw them from
+    int alphabet;  // the number of activities, at most 26
+    int length;    // the mean number of events of a trace
+    int codeHeavy; // whether traces are built from fixed blocks of
+                   //     activities, which stage 1 and 2 fold into many codes
+    unsigned long long seed; // the seed of the generator
+} shape_t;
+
+enum
+{
+    PH_LOAD,     // splitting the buffer into traces
+    PH_DEDUP,    // finding the distinct traces
+    PH_DISTINCT, // finding the distinct events and their frequencies
+    PH_DF,       // building the DF relation
+    PH_SEARCH,   // scoring pairs and picking patterns
+    PH_REWRITE,  // folding patterns into the log and the DF relation
+    NPHASE
+};
+
+static const char *phaseName[NPHASE] = {"load", "dedup", "distinct events",
+                                        "DF build", "pattern search", "rewrite"};
+
+/* Generator -----------------------------------------------------------------*/
+
+// returns the next number of a splitmix64 sequence, so a seed always gives
+// the same log
+unsigned long long nextRand(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// writes one variant of the given shape into out and returns its length;
+// a plain variant walks the alphabet in order with some noise, a code heavy
+// one repeats pairs of activities that always follow each other
+int genVariant(shape_t *sh, unsigned long long *state, char *out)
+{
+    int len = sh->length / 2 + (int)(nextRand(state) % (sh->length + 1));
+    if (len < 1)
+        len = 1;
+    int n = 0;
+    if (sh->codeHeavy)
+    {
+        int nBlocks = sh->alphabet / 2 ? sh->alphabet / 2 : 1;
+        while (n < len)
+        {
+            int b = (int)(nextRand(state) % nBlocks);
+            out[n++] = 'a' + 2 * b;
+            if (2 * b + 1 < sh->alphabet)
+                out[n++] = 'a' + 2 * b + 1;
+        }
+        return n;
+    }
+    for (int i = 0; i < len; i++)
+    {
+        int j = i * sh->alphabet / len + (int)(nextRand(state) % 4) - 1;
+        j = j < 0 ? 0 : j >= sh->alphabet ? sh->alphabet - 1 : j;
+        out[n++] = 'a' + j;
+    }
+    return n;
+}
+
+// generates a log of the given shape, one trace per line, and stores its
+// size in len; the variants are drawn with a skew, so a few are frequent
+char *genLog(shape_t *sh, size_t *len)
+{
+    unsigned long long state = sh->seed;
+    int maxLen = sh->length * 2 + 2;
+    char *vars = malloc((size_t)sh->variants * maxLen);
+    int *varLen = malloc(sizeof(int) * sh->variants);
+    size_t total = 0;
+    for (int v = 0; v < sh->variants; v++)
+        varLen[v] = genVariant(sh, &state, vars + (size_t)v * maxLen);
+
+    int *pick = malloc(sizeof(int) * sh->cases);
+    for (int i = 0; i < sh->cases; i++)
+    {
+        int r = (int)(nextRand(&state) % sh->variants);
+        pick[i] = (int)(nextRand(&state) % (r + 1));
+        total += varLen[pick[i]] + 1;
+    }
+
+    char *buf = malloc(total ? total : 1);
+    size_t pos = 0;
+    for (int i = 0; i < sh->cases; i++)
+    {
+        memcpy(buf + pos, vars + (size_t)pick[i] * maxLen, varLen[pick[i]]);
+        pos += varLen[pick[i]];
+        buf[pos++] = '\n';
+    }
+    free(vars);
+    free(varLen);
+    free(pick);
+    *len = total;
+    return buf;
+}
+
+/* Benchmark -----------------------------------------------------------------*/
+
+// runs every phase of both stages once over the log in buf, adding the time
+// spent in each phase to secs; returns the number of patterns folded
+int benchOnce(const char *buf, size_t len, int threads, double *secs)
+{
+    miner_t *m = minerNew(threads);
+    double t = minerNow();
+    store_t st = {0};
+    if (minerLoadBuffer(&st, buf, len) < 0)
+    {
+        perror("bench");
+        exit(EXIT_FAILURE);
+    }
+    secs[PH_LOAD] += minerNow() - t;
+
+    t = minerNow();
+    if (minerCalcTrcsFreq(&m->log, &st) < 0)
+    {
+        perror("bench");
+        exit(EXIT_FAILURE);
+    }
+    minerFreeStore(&st);
+    secs[PH_DEDUP] += minerNow() - t;
+
+    t = minerNow();
+    int nDistEvts;
+    action_t *distEvts = minerFindDistinctEvents(&m->log, &nDistEvts);
+    count_t *evtFreqs = minerCalcEvtFreq(&m->log, distEvts, nDistEvts, threads);
+    free(distEvts);
+    free(evtFreqs);
+    secs[PH_DISTINCT] += minerNow() - t;
+
+    t = minerNow();
+    minerInitDFMatrix(&m->df, &m->log);
+    secs[PH_DF] += minerNow() - t;
+
+    int nPatterns = 0;
+    for (int stage = 1; stage <= 2; stage++)
+    {
+        node_t nd;
+        for (;;)
+        {
+            t = minerNow();
+            int found = minerFindPattern(m, stage, &nd);
+            secs[PH_SEARCH] += minerNow() - t;
+            if (!found)
+                break;
+            t = minerNow();
+            minerFoldPattern(m, &nd);
+            secs[PH_REWRITE] += minerNow() - t;
+            nPatterns++;
+        }
+    }
+    minerFree(m);
+    return nPatterns;
+}
+
+int main(int argc, char *argv[])
+{
+    shape_t sh = {DEFAULT_CASES, DEFAULT_VARIANTS, DEFAULT_ALPHABET,
+                  DEFAULT_LENGTH, 0, DEFAULT_SEED};
+    int reps = DEFAULT_REPS;
+    int threads = DEFAULT_THREADS;
+    char *outFile = NULL;
+    for (int i = 1; i < argc; i++)
+    {
+        char *opt = argv[i];
+        if (strcmp(opt, "-c") == 0)
+            sh.codeHeavy = 1;
+        else if (strcmp(opt, "-o") == 0 && i + 1 < argc)
+            outFile = argv[++i];
+        else if (strcmp(opt, "-n") == 0 && i + 1 < argc)
+            sh.cases = atoi(argv[++i]);
+        else if (strcmp(opt, "-v") == 0 && i + 1 < argc)
+            sh.variants = atoi(argv[++i]);
+        else if (strcmp(opt, "-a") == 0 && i + 1 < argc)
+            sh.alphabet = atoi(argv[++i]);
+        else if (strcmp(opt, "-l") == 0 && i + 1 < argc)
+            sh.length = atoi(argv[++i]);
+        else if (strcmp(opt, "-s") == 0 && i + 1 < argc)
+            sh.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(opt, "-r") == 0 && i + 1 < argc)
+            reps = atoi(argv[++i]);
+        else if (strcmp(opt, "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-n cases] [-v variants] [-a alphabet] "
+                            "[-l length] [-s seed] [-c] [-r reps] [-t threads] "
+                            "[-o log.txt]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (sh.alphabet < 1 || sh.alphabet > 26 || sh.variants < 1 || sh.cases < 0 ||
+        sh.length < 1 || reps < 1)
+    {
+        fprintf(stderr, "%s: the alphabet takes 1 to 26 activities, the other "
+                        "sizes must be positive\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t len;
+    char *buf = genLog(&sh, &len);
+    if (outFile)
+    {
+        FILE *fp = fopen(outFile, "wb");
+        if (fp == NULL || fwrite(buf, 1, len, fp) != len)
+        {
+            perror(outFile);
+            exit(EXIT_FAILURE);
+        }
+        fclose(fp);
+        free(buf);
+        return 0;
+    }
+
+    double secs[NPHASE] = {0};
+    int nPatterns = 0;
+    for (int r = 0; r < reps; r++)
+        nPatterns = benchOnce(buf, len, threads, secs);
+
+    printf("cases %d, variants %d, alphabet %d, length %d, seed %llu%s\n",
+           sh.cases, sh.variants, sh.alphabet, sh.length, sh.seed,
+           sh.codeHeavy ? ", code heavy" : "");
+    printf("%zu bytes, %d patterns, %d threads, %d reps\n", len, nPatterns,
+           threads, reps);
+    double total = 0;
+    for (int p = 0; p < NPHASE; p++)
+    {
+        printf("%-16s %10.3f ms\n", phaseName[p], 1e3 * secs[p] / reps);
+        total += secs[p];
+    }
+    printf("%-16s %10.3f ms\n", "total", 1e3 * total / reps);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "miner.h"
+
+// Checks that a mined process tree replays its own training log at 100%
+// fitness, for synthetic logs mined one pattern at a time, in batches and
+// over a prefix tree. Exits with 0 if every log fits.
+// Build: make check, which builds and runs it as build/fittest
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define DEFAULT_SEEDS 20
+#define FIT_CASES 400
+#define FIT_VARIANTS 40
+#define FIT_LENGTH 10
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct
+{                  // a way of mining a log
+    const char *name; // printed with the outcome
+    int batch;        // BATCH_NONE, BATCH_FAST or BATCH_EXACT
+    int prefix;       // whether the patterns are folded over a prefix tree
+} fitMode_t;
+
+static const fitMode_t modes[] = {
+    {"one by one", BATCH_NONE, 0},
+    {"fast batch", BATCH_FAST, 0},
+    {"exact batch", BATCH_EXACT, 0},
+    {"prefix tree", BATCH_NONE, 1},
+    {"prefix tree, exact batch", BATCH_EXACT, 1},
+};
+
+// activity names for the CSV logs, some of which need quoting
+static const char *csvNames[] = {"Register", "Check, Credit", "Pay", "Ship",
+                                 "Say \"hi\"", "Archive", "Refund", "Close"};
+
+/* Generator -----------------------------------------------------------------*/
+
+// returns the next number of a splitmix64 sequence, so a seed always gives
+// the same log
+unsigned long long nextRand(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// writes one variant over nact activities into out and returns its length;
+// it mostly walks the activities in order, with swaps, skips and repeats,
+// so the miner finds every kind of pattern and folds runs of its blocks
+int genVariant(unsigned long long *state, int nact, int *out)
+{
+    int len = FIT_LENGTH / 2 + (int)(nextRand(state) % (FIT_LENGTH + 1));
+    for (int i = 0; i < len; i++)
+    {
+        int j = i * nact / len + (int)(nextRand(state) % 3) - 1;
+        out[i] = j < 0 ? 0 : j >= nact ? nact - 1 : j;
+        if (i > 0 && nextRand(state) % 8 == 0)
+            out[i] = out[i - 1];
+    }
+    return len;
+}
+
+// writes a log of FIT_CASES cases to a new temporary file and returns its
+// name, as letters or, if csv is set, as case,activity rows of names
+char *genLog(unsigned long long seed, int csv)
+{
+    unsigned long long state = seed;
+    int nact = csv ? (int)(sizeof(csvNames) / sizeof(csvNames[0]))
+                   : 4 + (int)(nextRand(&state) % 12);
+    int vars[FIT_VARIANTS][2 * FIT_LENGTH];
+    int varLen[FIT_VARIANTS];
+    for (int v = 0; v < FIT_VARIANTS; v++)
+        varLen[v] = genVariant(&state, nact, vars[v]);
+
+    char *name = strdup("/tmp/fittestXXXXXX");
+    int fd = mkstemp(name);
+    FILE *fp = fd < 0 ? NULL : fdopen(fd, "w");
+    if (fp == NULL)
+    {
+        perror("fittest");
+        exit(EXIT_FAILURE);
+    }
+    if (csv)
+        fputs("case,activity\n", fp);
+    for (int i = 0; i < FIT_CASES; i++)
+    {
+        int r = (int)(nextRand(&state) % FIT_VARIANTS);
+        int v = (int)(nextRand(&state) % (r + 1));
+        for (int k = 0; k < varLen[v]; k++)
+        {
+            if (!csv)
+                fputc('a' + vars[v][k], fp);
+            else if (strpbrk(csvNames[vars[v][k]], ",\""))
+            {
+                fprintf(fp, "c%d,\"", i);
+                for (const char *s = csvNames[vars[v][k]]; *s; s++)
+                {
+                    if (*s == '"')
+                        fputc('"', fp);
+                    fputc(*s, fp);
+                }
+                fputs("\"\n", fp);
+            }
+            else
+                fprintf(fp, "c%d,%s\n", i, csvNames[vars[v][k]]);
+        }
+        if (!csv)
+            fputc('\n', fp);
+    }
+    fclose(fp);
+    return name;
+}
+
+/* Check ---------------------------------------------------------------------*/
+
+// mines the log in logFile the given way, writes the tree to modelFile and
+// replays the log on it; returns 1 if every case fits, 0 otherwise
+int fitsOwnLog(const char *logFile, int csv, const fitMode_t *md, const char *modelFile)
+{
+    miner_t *m = minerNew(DEFAULT_THREADS);
+    m->batch = md->batch;
+    int res = csv ? minerReadCsvFile(m, logFile) : minerReadFile(m, logFile);
+    if (res == 0)
+    {
+        if (md->prefix)
+            minerUseTrie(m);
+        minerRunStage(m, 1);
+        minerRunStage(m, 2);
+        res = minerSaveModel(m, modelFile);
+    }
+    minerFree(m);
+
+    model_t model;
+    replay_t rp;
+    if (res < 0 || minerLoadModel(&model, modelFile) < 0)
+    {
+        perror(logFile);
+        return 0;
+    }
+    res = minerReplayFile(&model, logFile, csv, DEFAULT_THREADS, &rp);
+    int ok = res == 0 && rp.nfit == rp.log.ndtr && rp.nfitCas == rp.log.ncas;
+    if (!ok)
+        printf("FAIL %s %s: %d of %d distinct traces fit\n", logFile, md->name,
+               rp.nfit, rp.log.ndtr);
+    if (res == 0)
+        minerFreeReplay(&rp);
+    minerFreeModel(&model);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    int seeds = argc > 1 ? atoi(argv[1]) : DEFAULT_SEEDS;
+    if (argc > 2 || seeds < 1)
+    {
+        fprintf(stderr, "usage: %s [seeds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    char modelFile[] = "/tmp/fittestXXXXXX";
+    int fd = mkstemp(modelFile);
+    if (fd < 0)
+    {
+        perror("fittest");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    int nmode = sizeof(modes) / sizeof(modes[0]);
+    int runs = 0, fails = 0;
+    for (int s = 1; s <= seeds; s++)
+    {
+        for (int csv = 0; csv < 2; csv++)
+        {
+            char *logFile = genLog((unsigned long long)s, csv);
+            for (int k = 0; k < nmode; k++)
+            {
+                runs++;
+                fails += !fitsOwnLog(logFile, csv, &modes[k], modelFile);
+            }
+            unlink(logFile);
+            free(logFile);
+        }
+    }
+    unlink(modelFile);
+    printf("%d of %d mined models fit their own log\n", runs - fails, runs);
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
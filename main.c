@@ -1,803 +1,604 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
-#include <assert.h>
 
-/* #DEFINE'S -----------------------------------------------------------------*/
-#define DEFAULT_TOTAL_CAPACITY 15
-#define DEFAULT_DISTINCT_CAPACITY 5
-
-/* TYPE DEFINITIONS ----------------------------------------------------------*/
-typedef unsigned int action_t; // an action is identified by an integer
-
-typedef struct event event_t; // an event ...
-struct event
-{                  // ... is composed of ...
-    action_t actn; // ... an action that triggered it and ...
-    event_t *next; // ... a pointer to the next event in the trace
-};
-
-typedef struct
-{                  // a trace is a linked list of events
-    event_t *head; // a pointer to the first event in this trace
-    event_t *foot; // a pointer to the last event in this trace
-    int freq;      // the number of times this trace was observed
-} trace_t;
+#include "miner.h"
+#include "output.h"
+#include "service.h"
 
 typedef struct
-{                  // an event log is an array of distinct traces
-                   //     sorted lexicographically
-    trace_t *trcs; // an array of traces
-    int ndtr;      // the number of distinct traces in this log
-    int cpct;      // the capacity of this event log as the number
-                   //     of  distinct traces it can hold
-} log_t;
-
-typedef action_t **DF_t; // a directly follows relation over actions
-
-// prints a given trace
-void printTrace(trace_t *tr)
+{                  // what a run prints and where
+    out_t out;     // the text output
+    out_t mats;    // the matrix output, fp NULL to print matrices as text
+                   //     into out at full verbosity
+    int verbosity; // VERB_QUIET, VERB_SUMMARY or VERB_FULL
+    thresh_t *ths; // the sets of thresholds every stage starts with a
+    int nths;      //     sweep of, none if nths is 0
+} cli_t;
+
+// prints the frequencies of the actions still in the log
+void printFreqs(out_t *o, miner_t *m)
 {
-    event_t *evt = tr->head;
-    while (1)
+    dfmat_t mat = {0};
+    minerGetFreqs(m, &mat);
+    for (int i = 0; i < mat.n; i++)
     {
-        if (isalpha(evt->actn))
-            printf("%c", evt->actn);
-        else
-            printf("%d", evt->actn);
-        if (evt == tr->foot)
-        {
-            printf("\n");
-            break;
-        }
-        evt = evt->next;
+        outAction(o, mat.actns[i], 0);
+        outStr(o, " = ");
+        outInt(o, mat.freqs[i], 0);
+        outChar(o, '\n');
     }
+    minerFreeDFMat(&mat);
 }
 
-void addEvt(trace_t *tr, event_t *evt)
+// prints the DF matrix a round starts from, if any output wants it
+void printMatrix(cli_t *cli, miner_t *m, int stage, int round)
 {
-    if (tr->head == NULL)
-    {
-        tr->head = evt;
-        tr->foot = tr->head;
-    }
-    else
-    {
-        tr->foot->next = evt;
-        tr->foot = evt;
-    }
+    out_t *o = cli->mats.fp ? &cli->mats : &cli->out;
+    if (o == &cli->out && cli->verbosity < VERB_FULL)
+        return;
+    dfmat_t mat = {0};
+    minerGetDF(m, &mat);
+    outMatrix(o, &mat, stage, round);
+    minerFreeDFMat(&mat);
 }
 
-/* Load all the events and traces-----------------------------------------------------------------*/
-
-trace_t *loadTrace(char *str)
+// prints the trace of every case as the folds so far left it
+void printCases(out_t *o, miner_t *m)
 {
-    trace_t *tr = malloc(sizeof(trace_t *));
-    for (int i = 0; str[i]; i++)
-    {
-        if (isalpha(str[i]))
-        {
-            action_t a = str[i];
-            event_t *evt = malloc(sizeof(event_t *));
-            evt->actn = a;
-            addEvt(tr, evt);
-        }
-    }
-    return tr;
+    if (m->prefix)
+        outTrieCases(o, &m->trie, &m->log);
+    else
+        outCases(o, &m->log);
 }
 
-// loads all the tracees from file
-trace_t **initTrcsFromFile(trace_t **trcs, int *trcsCap, char *filename)
+// prints the events the fold of a pattern removed
+void printRemoved(out_t *o, node_t *nd)
 {
-    FILE *fp;
-    char *line = NULL;
-    size_t len = 0;
-    ssize_t read;
-
-    fp = fopen(filename, "r");
-    if (fp == NULL)
-        exit(EXIT_FAILURE);
+    outStr(o, "Number of events removed: ");
+    outInt(o, nd->removed, 0);
+    outChar(o, '\n');
+}
 
-    int i = 0;
-    while ((read = getline(&line, &len, fp)) != -1)
+// prints the pattern a window would start a stage with and its weight
+void printPick(out_t *o, sweep_t *sw)
+{
+    static const char *typeStr[] = {"CHC", "CON", "SEQ"};
+    node_t *nd = &sw->best;
+    if (nd->type < 0)
     {
-        if (i == *trcsCap)
-        {
-            *trcsCap = *trcsCap * 2;
-            trcs = realloc(trcs, sizeof(trace_t *) * *trcsCap);
-        }
-        trcs[i] = loadTrace(line);
-        i++;
+        outStr(o, "none");
+        return;
     }
-
-    fclose(fp);
-    if (line)
-        free(line);
-    *trcsCap = i;
-    trcs = realloc(trcs, sizeof(trace_t *) * *trcsCap);
-    return trcs;
+    outStr(o, typeStr[nd->type]);
+    outChar(o, '(');
+    outAction(o, nd->x, 0);
+    outChar(o, ',');
+    outAction(o, nd->y, 0);
+    outStr(o, ") ");
+    outInt(o, sw->weight, 0);
 }
 
-/* Stage 0 -------------------------------------------------------------------------------------*/
-
-// find all the distinct events in the given traces
-action_t *findDistinctEvents(trace_t **trcs, int size, int *nDistEvts)
+// prints the buckets and the pattern every set of thresholds of the sweep
+// would start the stage with
+void printSweep(cli_t *cli, miner_t *m, int stage)
 {
-    int distCap = 2;
-    int nDist = 0;
-    action_t *distEvts = malloc(sizeof(action_t) * distCap);
-
-    for (int i = 0; i < size; i++)
+    out_t *o = &cli->out;
+    sweep_t *sw = malloc(sizeof(sweep_t) * cli->nths);
+    minerSweep(m, stage, cli->ths, cli->nths, sw);
+    for (int i = 0; i < cli->nths; i++)
     {
-        event_t *cur = trcs[i]->head;
-        while (1)
-        {
-            int isDist = 1;
-            for (int j = 0; j < nDist; j++)
-            {
-                if (distEvts[j] == cur->actn)
-                {
-                    isDist = 0;
-                    break;
-                }
-            }
-            if (isDist)
-            {
-                if (nDist == distCap)
-                {
-                    distCap *= 2;
-                    distEvts = realloc(distEvts, distCap);
-                }
-                distEvts[nDist++] = cur->actn;
-            }
-            if (cur == trcs[i]->foot)
-            {
-                break;
-            }
-            cur = cur->next;
-        }
+        outStr(o, "sweep ");
+        outInt(o, sw[i].th.seqPd, 0);
+        outChar(o, ',');
+        outInt(o, sw[i].th.conPd, 0);
+        outChar(o, ',');
+        outInt(o, sw[i].th.chcPct, 0);
+        outStr(o, " seq ");
+        outInt(o, sw[i].nCls[PAT_SEQ], 0);
+        outStr(o, " chc ");
+        outInt(o, sw[i].nCls[PAT_CHC], 0);
+        outStr(o, " con ");
+        outInt(o, sw[i].nCls[PAT_CON], 0);
+        outStr(o, " pick ");
+        printPick(o, &sw[i]);
+        outChar(o, '\n');
     }
-    for (int step = 0; step < nDist - 1; step++)
-    {
-        int min_idx = step;
-        for (int i = step + 1; i < nDist; i++)
-        {
-            // Select the minimum element in each loop.
-            // if (array[i] < array[min_idx])
-            //     min_idx = i;
-            if (distEvts[i] < distEvts[min_idx])
-                min_idx = i;
-        }
-        // put min at the correct position
-        action_t temp = distEvts[min_idx];
-        distEvts[min_idx] = distEvts[step];
-        distEvts[step] = temp;
-    }
-    *nDistEvts = nDist;
-    return distEvts;
+    free(sw);
 }
 
-// counts the total number of events in the given tracecs
-int countEvts(trace_t **trcs, int size)
+// runs one stage a batch of disjoint patterns per round, printing the DF
+// matrix before and the log after every batch
+void printBatches(cli_t *cli, miner_t *m, int stage)
 {
-    int nEvts = 0;
-    for (int i = 0; i < size; i++)
+    out_t *o = &cli->out;
+    int verb = cli->verbosity;
+    int max = m->df.nlive / 2 + 1;
+    node_t *nds = malloc(sizeof(node_t) * max);
+    int k;
+    for (int i = 1; (k = minerFindBatch(m, stage, m->batch == BATCH_EXACT, nds, max)) > 0; i++)
     {
-        event_t *cur = trcs[i]->head;
-        while (1)
+        if (i != 1 && verb >= VERB_SUMMARY)
+            outStr(o, "=====================================\n");
+        printMatrix(cli, m, stage, i);
+
+        minerFoldBatch(m, nds, k);
+        if (stage == 1 && verb >= VERB_FULL)
+            printCases(o, m);
+        if (verb >= VERB_SUMMARY)
+            outStr(o, "-------------------------------------\n");
+        for (int j = 0; j < k; j++)
         {
-            nEvts++;
-            if (cur == trcs[i]->foot)
-            {
-                break;
-            }
-            cur = cur->next;
+            outNode(o, &nds[j]);
+            if (verb >= VERB_SUMMARY)
+                printRemoved(o, &nds[j]);
         }
+        if (verb >= VERB_SUMMARY)
+            printFreqs(o, m);
     }
-    return nEvts;
+    free(nds);
 }
 
-// calculates the frequencies of all the events in the given traces
-// returns an array of frequencies.
-// The index of frequency in the returned array corresponds to the event's
-// index in lexicographical order
-int *calcEvtFreq(trace_t **trcs, int size, action_t *actns, int nDistEvts)
+// runs one stage, printing the DF matrix before and the log after every fold
+void printStage(cli_t *cli, miner_t *m, int stage)
 {
-    int *evtFreqs = malloc(sizeof(int) * nDistEvts);
-    for (int j = 0; j < nDistEvts; j++)
+    if (cli->nths)
+        printSweep(cli, m, stage);
+    if (m->batch != BATCH_NONE)
     {
-        evtFreqs[j] = 0;
+        printBatches(cli, m, stage);
+        return;
     }
-    for (int i = 0; i < size; i++)
+    out_t *o = &cli->out;
+    int verb = cli->verbosity;
+    node_t nd;
+    for (int i = 1; minerFindPattern(m, stage, &nd); i++)
     {
-        event_t *cur = trcs[i]->head;
-        while (1)
-        {
-            for (int j = 0; j < nDistEvts; j++)
-            {
-                if (actns[j] == cur->actn)
-                {
-                    evtFreqs[j]++;
-                }
-            }
-            if (cur == trcs[i]->foot)
-            {
-                break;
-            }
-            cur = cur->next;
-        }
-    }
-    return evtFreqs;
-}
+        if (i != 1 && verb >= VERB_SUMMARY)
+            outStr(o, "=====================================\n");
+        printMatrix(cli, m, stage, i);
 
-// checks whether two traces are equal
-int equals(trace_t *tr1, trace_t *tr2)
-{
-    event_t *evt1 = tr1->head;
-    event_t *evt2 = tr2->head;
-    // printf("--------------------\nComparing traces : \n");
-    // printTrace(tr1);
-    // printTrace(tr2);
-
-    int result = 0;
-    while (1)
-    {
-        if (evt1 == tr1->foot && evt2 == tr2->foot)
+        if (stage == 1)
         {
-            result = evt1->actn == evt2->actn;
-            break;
+            minerFoldPattern(m, &nd);
+            if (verb >= VERB_FULL)
+                printCases(o, m);
+            if (verb >= VERB_SUMMARY)
+                outStr(o, "-------------------------------------\n");
+            outNode(o, &nd);
         }
-        // printf("%c", evt->actn);
-        if ((evt1 == tr1->foot) || (evt2 == tr2->foot))
+        else
         {
-            result = 0;
-            break;
+            if (verb >= VERB_SUMMARY)
+                outStr(o, "-------------------------------------\n");
+            outNode(o, &nd);
+            minerFoldPattern(m, &nd);
         }
-        if (evt1->actn != evt2->actn)
+        if (verb >= VERB_SUMMARY)
         {
-            result = 0;
-            break;
+            printRemoved(o, &nd);
+            printFreqs(o, m);
         }
-        evt1 = evt1->next;
-        evt2 = evt2->next;
     }
-    return result;
 }
 
-// counts all the distinct traces in the given traces
-int countDistinctTraces(trace_t **trcs, int size)
+// prints the statistics of the log as it was read
+void printStage0(out_t *o, miner_t *m)
 {
-    int nDist = 1;
-    for (int i = 1; i < size; i++)
+    stats_t st = {0};
+    minerStage0(m, &st);
+    outStr(o, "Number of distinct events: ");
+    outInt(o, st.nDistEvts, 0);
+    outStr(o, "\nNumber of distinct traces: ");
+    outInt(o, st.nDistTrcs, 0);
+    outStr(o, "\nTotal number of events: ");
+    outInt(o, st.nEvts, 0);
+    outStr(o, "\nTotal number of traces: ");
+    outInt(o, st.nTrcs, 0);
+    outStr(o, "\nMost frequent trace frequency: ");
+    outInt(o, st.maxFreq, 0);
+    outChar(o, '\n');
+    if (st.maxLen)
+        outActns(o, st.maxTrc, st.maxLen);
+    for (int i = 0; i < st.nDistEvts; i++)
     {
-        int j = 0;
-        for (j = 0; j < i; j++)
-        {
-            if (equals(trcs[i], trcs[j]))
-                break;
-        }
-
-        // If not printed earlier, then print it
-        if (i == j)
-            nDist++;
+        outAction(o, st.distEvts[i], 0);
+        outStr(o, " = ");
+        outInt(o, st.evtFreqs[i], 0);
+        outChar(o, '\n');
     }
-    return nDist;
+    minerFreeStats(&st);
 }
 
-// calculates the frequencies of the given traces
-//  returns an array of frequencies.
-//  The index of frequency in the returned array corresponds to the trace's
-//  index in lexicographical order
-void calcTrcsFreq(trace_t **trcs, int size)
+// prints how many distinct traces and cases of a replayed log fit the model,
+// and at full verbosity every distinct trace that does not
+void printReplay(out_t *o, replay_t *rp, int verbosity)
 {
-    for (int i = 0; i < size; i++)
+    log_t *log = &rp->log;
+    outStr(o, "Distinct traces fitting: ");
+    outInt(o, rp->nfit, 0);
+    outStr(o, " of ");
+    outInt(o, log->ndtr, 0);
+    outStr(o, "\nCases fitting: ");
+    outInt(o, rp->nfitCas, 0);
+    outStr(o, " of ");
+    outInt(o, log->ncas, 0);
+    outChar(o, '\n');
+    if (verbosity < VERB_FULL)
+        return;
+    for (int i = 0; i < log->ndtr; i++)
     {
-        for (int j = 0; j < size; j++)
-        {
-            if (!equals(trcs[i], trcs[j]))
-                continue;
-
-            if (j < i)
-            {
-                trcs[i]->freq = trcs[j]->freq;
-                break;
-            }
-            trcs[i]->freq++;
-        }
+        if (rp->dev[i] < 0)
+            continue;
+        trace_t *tr = &log->trcs[i];
+        outInt(o, tr->freq, 0);
+        outStr(o, " cases deviate at event ");
+        outInt(o, rp->dev[i], 0);
+        outStr(o, ": ");
+        outActns(o, log->evts + tr->head, tr->foot - tr->head + 1);
     }
 }
 
-// returns the trace with the maximum frequency
-trace_t *getMaxFreqTrace(trace_t **trcs, int size)
+// replays the log in filename on the model in modelFile instead of mining it
+void replay(char *modelFile, char *filename, int csv, int threads,
+            int verbosity, FILE *metrics)
 {
-    trace_t *maxTr = NULL;
-    for (int i = 0; i < size; i++)
+    model_t md;
+    if (minerLoadModel(&md, modelFile) < 0)
     {
-        if (maxTr == NULL || trcs[i]->freq > maxTr->freq)
-        {
-            maxTr = trcs[i];
-        }
-    }
-    return maxTr;
-}
-
-// Initializes and returns the directly follows matrix
-DF_t initDFMatrix(action_t *distEvts, int nDistEvts, trace_t **trcs, int trSize)
-{
-    // printf("initdf ndist = %d", nDistEvts);
-
-    action_t max = distEvts[0],
-             min = distEvts[0];
-
-    for (int i = 0; i < nDistEvts; i++)
-    {
-        if (distEvts[i] > max)
-            max = distEvts[i];
-        if (distEvts[i] < min)
-            min = distEvts[i];
+        perror(modelFile);
+        exit(EXIT_FAILURE);
     }
-    // if (nDistEvts == 4)
-    // {
-    //     printf("\n MAX = %d , MIN = %d", max, min);
-    //     return NULL;
-    // }
-    DF_t matrix = malloc(sizeof(action_t *) * (max + 1 - min));
-
-    for (int r = 0; r < nDistEvts; r++)
+    replay_t rp;
+    double t = minerNow();
+    if (minerReplayFile(&md, filename, csv, threads, &rp) < 0)
     {
-        matrix[distEvts[r] - distEvts[0]] = (int *)malloc((max + 1 - min) * sizeof(action_t));
-        // printf("%d row init\n", r);
+        perror(filename);
+        exit(EXIT_FAILURE);
     }
+    if (metrics)
+        fprintf(metrics, "{\"phase\":\"replay\",\"ms\":%.3f,\"cases\":%d,"
+                         "\"traces\":%d,\"fitCases\":%d,\"fitTraces\":%d}\n",
+                1e3 * (minerNow() - t), rp.log.ncas, rp.log.ndtr, rp.nfitCas, rp.nfit);
+
+    out_t o;
+    outOpen(&o, stdout, MAT_TEXT);
+    o.names = &rp.log.names;
+    o.dict = &rp.log.dict;
+    printReplay(&o, &rp, verbosity);
+    outClose(&o);
+    minerFreeReplay(&rp);
+    minerFreeModel(&md);
+}
 
-    for (int r = 0; r < nDistEvts; r++)
+// prints, for every window of width buckets sliding one bucket at a time,
+// its cases, the buckets of its pairs and the first pattern of each stage;
+// cases go to buckets of perBucket cases, or of width seconds if secs > 0
+void printWindows(out_t *o, miner_t *m, int perBucket, double secs, int width)
+{
+    int *bucket = malloc(sizeof(int) * (m->log.ncas ? m->log.ncas : 1));
+    int nb = secs > 0 ? minerBucketByTime(&m->log, secs, bucket)
+                      : minerBucketByCount(&m->log, perBucket, bucket);
+    if (nb == 0)
     {
-        for (int c = 0; c < nDistEvts; c++)
-        {
-            // printf("%d,%d = %d", r, c, 0);
-            matrix[distEvts[r] - distEvts[0]][distEvts[c] - distEvts[0]] = 0;
-            // printf("%d,%d = %d\n", r, c, 0);
-        }
+        fprintf(stderr, secs > 0 ? "the log has no case times\n"
+                                 : "the log does not keep its cases\n");
+        exit(EXIT_FAILURE);
     }
-
-    int count = 0;
-    for (int i = 0; i < trSize; i++)
+    wdf_t w;
+    minerBuildWindows(&w, &m->log, bucket, nb);
+    free(bucket);
+    for (int from = 0; from + width <= nb || from == 0; from++)
     {
-        event_t *cur = trcs[i]->head;
-        while (1)
-        {
-            if (cur == trcs[i]->foot)
-            {
-                break;
-            }
-
-            for (int evt1Idx = 0; evt1Idx < nDistEvts; evt1Idx++)
-            {
-                for (int evt2Idx = 0; evt2Idx < nDistEvts; evt2Idx++)
-                {
-                    action_t evt1 = distEvts[evt1Idx];
-                    action_t evt2 = distEvts[evt2Idx];
-                    if (cur->actn == evt1 && cur->next->actn == evt2)
-                    {
-                        int row = evt1 - distEvts[0];
-                        int col = evt2 - distEvts[0];
-                        matrix[row][col]++;
-                    }
-                }
-            }
-            cur = cur->next;
-        }
+        int to = from + width < nb ? from + width : nb;
+        sweep_t sw[2];
+        int cases = minerWindow(m, &w, from, to, sw);
+        outStr(o, "window ");
+        outInt(o, from, 0);
+        outChar(o, '-');
+        outInt(o, to, 0);
+        outStr(o, " cases ");
+        outInt(o, cases, 0);
+        outStr(o, " seq ");
+        outInt(o, sw[1].nCls[PAT_SEQ], 0);
+        outStr(o, " chc ");
+        outInt(o, sw[1].nCls[PAT_CHC], 0);
+        outStr(o, " con ");
+        outInt(o, sw[1].nCls[PAT_CON], 0);
+        outStr(o, " stage1 ");
+        printPick(o, &sw[0]);
+        outStr(o, " stage2 ");
+        printPick(o, &sw[1]);
+        outChar(o, '\n');
     }
-    return matrix;
-}
-
-// support function
-// returns the support for event x and y, internally uses the Directly Follows matrix to retrieve the supports
-// Note that sup function takes events as inputs
-// sup(x, y) is NOT the same as matrix[x][y] as indices of the matrix start from 0 and go up until the number of elements
-int sup(action_t x, action_t y, action_t *distEvts, DF_t matrix)
-{
-    // printf("at 0 %d, ", distEvts[0]);
-    // return 0;
-    int row = x - distEvts[0];
-    int col = y - distEvts[0];
-    // printf("%c, %c,  %d, %d\n", x, y, row, col);
-    return (int)(matrix[row][col]);
+    minerFreeWindows(&w);
 }
 
-// pd function
-int pd(action_t x, action_t y, action_t *distEvts, DF_t matrix)
+// prints the usage of the program and ends it
+void usage(char *prog)
 {
-    int supxy = sup(x, y, distEvts, matrix);
-
-    int supyx = sup(y, x, distEvts, matrix);
-    // printf("just before sup(%c,%c)  = %d", y, x, supyx);
-    int max = supxy > supyx ? supxy : supyx;
-    // printf("max = %d", max);
-    // printf("calculating result");
-    int result = max > 0 ? (100 * abs(supxy - supyx)) / max : 0;
-    // printf("%d result", result);
-    return result;
+    fprintf(stderr, "usage: %s [-t threads] [-s | -c | -r] [-w snapshot] [-S part] [-o tree | -R tree] [-l | -u socket] [-i secs] [-B N[smhdw] [-K buckets]] [-P] [-b | -d] "
+                    "[-T seq,con,chc] [-m metrics.jsonl] [-v quiet|summary|full] "
+                    "[-M matrices [-f csv|bin]] log...\n"
+                    "  -T sets the pd above which pairs are sequences, the pd below\n"
+                    "     which they are concurrent and the percent of the live\n"
+                    "     actions up to which they are choices, 70,30,1 by default;\n"
+                    "     given more than once, mines with the first set and prints\n"
+                    "     the pattern every set would start each stage with\n"
+                    "  -c reads case,activity CSV rows after a header row\n"
+                    "  -r reads a snapshot written by -w instead of a log; given\n"
+                    "     several written by -S, merges them in order as one log\n"
+                    "  -S writes the counts of one shard of a log to a part file\n"
+                    "     and stops; no case may be split across two shards\n"
+                    "  -o writes the process tree found to a file\n"
+                    "  -R replays the log on a process tree written by -o\n"
+                    "  -l serves case,activity events and !tree, !stats and !quit\n"
+                    "     queries from stdin, -u from a unix socket, instead of a\n"
+                    "     log; -i finds the patterns every so many seconds\n"
+                    "  -B puts cases in buckets of N cases, or of N seconds, minutes,\n"
+                    "     hours, days or weeks with an s, m, h, d or w after N, by\n"
+                    "     the third CSV column; -K slides a window of that many\n"
+                    "     buckets over them and prints what each window would fold\n"
+                    "  -P folds a prefix tree of the distinct traces instead of\n"
+                    "     the log, for logs whose traces share long prefixes\n",
+            prog);
+    exit(EXIT_FAILURE);
 }
 
-// weight function
-int w(action_t x, action_t y, action_t *distEvts, DF_t matrix)
-{
-    int pdxy = pd(x, y, distEvts, matrix);
-    int supxy = sup(x, y, distEvts, matrix);
-    int supyx = sup(y, x, distEvts, matrix);
-    int max = supxy > supyx ? supxy : supyx;
-    return abs(50 - pdxy) * max;
-    // w(x, y) = abs(50 − pd(x, y)) × max(sup(x, y), sup(y, x));
-}
-
-// prints the Directly Follows matrix
-void printDFMatrix(DF_t seqMatrix, action_t *distEvts, int nDistEvts)
+/* WHERE IT ALL HAPPENS ------------------------------------------------------*/
+int main(int argc, char *argv[])
 {
-    printf("     ");
-    for (int i = 0; i < nDistEvts; i++)
+    char *filename = NULL;
+    char **files = malloc(sizeof(char *) * argc);
+    int nfile = 0;
+    char *shardFile = NULL;
+    char *metricsFile = NULL;
+    char *matFile = NULL;
+    char *snapFile = NULL;
+    char *modelOut = NULL;
+    char *modelIn = NULL;
+    char *sockPath = NULL;
+    int live = 0;
+    int interval = 0;
+    int perBucket = 0;
+    double bucketSecs = 0;
+    int width = 1;
+    int matFmt = MAT_CSV;
+    int verbosity = VERB_FULL;
+    int stream = 0;
+    int prefix = 0;
+    int csv = 0;
+    int snap = 0;
+    int batch = BATCH_NONE;
+    int threads = DEFAULT_THREADS;
+    thresh_t th;
+    minerDefaultThresh(&th);
+    thresh_t *ths = malloc(sizeof(thresh_t) * argc);
+    int nths = 0;
+    for (int i = 1; i < argc; i++)
     {
-        if (isalpha(distEvts[i]))
-            printf("%5c", distEvts[i]);
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0)
+            stream = 1;
+        else if (strcmp(argv[i], "-c") == 0)
+            csv = 1;
+        else if (strcmp(argv[i], "-r") == 0)
+            snap = 1;
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            snapFile = argv[++i];
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc)
+            shardFile = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            modelOut = argv[++i];
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc)
+            modelIn = argv[++i];
+        else if (strcmp(argv[i], "-l") == 0)
+            live = 1;
+        else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc)
+        {
+            live = 1;
+            sockPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            interval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc)
+        {
+            char *unit;
+            double v = strtod(argv[++i], &unit);
+            const char *units = "smhdw";
+            static const double secs[] = {1, 60, 3600, 86400, 604800};
+            if (!(v > 0))
+                usage(argv[0]);
+            if (*unit == '\0')
+                perBucket = (int)v;
+            else if (unit[1] == '\0' && strchr(units, *unit))
+                bucketSecs = v * secs[strchr(units, *unit) - units];
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc)
+            width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc)
+        {
+            i++;
+            ths[nths] = th;
+            if (sscanf(argv[i], "%d,%d,%d", &ths[nths].seqPd, &ths[nths].conPd,
+                       &ths[nths].chcPct) != 3)
+                usage(argv[0]);
+            nths++;
+        }
+        else if (strcmp(argv[i], "-P") == 0)
+            prefix = 1;
+        else if (strcmp(argv[i], "-b") == 0)
+            batch = BATCH_FAST;
+        else if (strcmp(argv[i], "-d") == 0)
+            batch = BATCH_EXACT;
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            metricsFile = argv[++i];
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+            matFile = argv[++i];
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "csv") == 0)
+                matFmt = MAT_CSV;
+            else if (strcmp(argv[i], "bin") == 0)
+                matFmt = MAT_BIN;
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "quiet") == 0)
+                verbosity = VERB_QUIET;
+            else if (strcmp(argv[i], "summary") == 0)
+                verbosity = VERB_SUMMARY;
+            else if (strcmp(argv[i], "full") == 0)
+                verbosity = VERB_FULL;
+            else
+                usage(argv[0]);
+        }
         else
-            printf("%5d", distEvts[i]);
+            files[nfile++] = argv[i];
     }
-    printf("\n");
-    for (int row = 0; row < nDistEvts; row++)
+    filename = nfile ? files[0] : NULL;
+    if (nths)
+        th = ths[0];
+    if (live)
     {
-        if (isalpha(distEvts[row]))
-            printf("%5c", distEvts[row]);
-        else
-            printf("%5d", distEvts[row]);
-        for (int col = 0; col < nDistEvts; col++)
+        if (filename || modelIn || csv || stream || snap || snapFile || modelOut || prefix ||
+            shardFile)
+            usage(argv[0]);
+        free(files);
+        miner_t *m = minerNew(threads);
+        m->batch = batch;
+        m->th = th;
+        if (runService(m, sockPath, interval) < 0)
         {
-            printf("%5d", seqMatrix[distEvts[row] - distEvts[0]][distEvts[col] - distEvts[0]]);
+            perror(sockPath);
+            exit(EXIT_FAILURE);
         }
-        printf("\n");
+        minerFree(m);
+        return 0;
     }
-}
-
-void replace(action_t x, action_t code, trace_t **trcs, int trSize)
-{
-    for (int i = 0; i < trSize; i++)
+    int windows = perBucket > 0 || bucketSecs > 0;
+    if (filename == NULL || csv + stream + snap > 1 || width < 1 || (nfile > 1 && !snap) ||
+        (shardFile && (modelIn || windows)) ||
+        (modelIn && (stream || snap || snapFile || modelOut)) ||
+        (windows && (modelIn || stream || prefix)) || (prefix && modelIn))
+        usage(argv[0]);
+
+    FILE *metrics = NULL;
+    if (metricsFile)
     {
-        event_t *cur = trcs[i]->head;
-        while (1)
+        metrics = fopen(metricsFile, "w");
+        if (metrics == NULL)
         {
-            if (cur->actn == x)
-                cur->actn = code;
-            if (cur == trcs[i]->foot)
-                break;
-            cur = cur->next;
+            perror(metricsFile);
+            exit(EXIT_FAILURE);
         }
     }
-}
-
-int abstractPair(action_t z, trace_t **trcs, int trSize)
-{
-    int nEvts = 0;
-    for (int i = 0; i < trSize; i++)
+    if (modelIn)
     {
-        event_t *e1 = trcs[i]->head;
-        event_t *e2 = trcs[i]->head->next;
-
-        while (1)
-        {
-            if (e1->actn != z || e2->actn != z)
-            {
-                if (e2 == trcs[i]->foot)
-                    break;
-                e1 = e1->next;
-                e2 = e2->next;
-                // if (i == 0)
-                //     printf("e1 = %d, e2 = %d", e1->actn, e2->actn);
-                // continue;
-            }
-            else
-            {
-                // if (x == 'e')
-                // {
-                //     printf("char %d -> %d\t", e1->actn, e2->actn);
-                // }
-                // e1->actn = z;
-                if (e2 != trcs[i]->foot)
-                {
-                    e1->next = e2->next;
-                    free(e2);
-                    e2 = e1->next;
-                    // if (x == 'e')
-                    // {
-                    //     printf("char %d -> %d -> %d\n", e1->actn, e2->actn, e2->next->actn);
-                    // }
-                    nEvts++;
-                }
-                else
-                {
-                    e1->next = NULL;
-                    trcs[i]->foot = e1;
-                    nEvts++;
-                    free(e2);
-                    // if (x == 'e')
-                    // {
-                    //     printf("char %d -> %d -> %d\n", e1->actn, e2->actn, e2->next->actn);
-                    // }
-                    break;
-                }
-            }
-        }
+        replay(modelIn, filename, csv, threads, verbosity, metrics);
+        if (metrics)
+            fclose(metrics);
+        free(files);
+        return 0;
     }
-    // number of events removed
-    return nEvts;
-}
 
-void getSeq(action_t *outX, action_t *outY, action_t *distEvts, int nDistEvts, DF_t seqMatrix)
-{
-    action_t x = 0, y = 0;
-    for (int row = 0; row < nDistEvts; row++)
+    miner_t *m = minerNew(threads);
+    m->batch = batch;
+    m->th = th;
+    m->metrics = metrics;
+    int res = csv      ? minerReadCsvFile(m, filename)
+              : stream ? minerStreamFile(m, filename)
+              : snap   ? minerMergeSnapshots(m, files, nfile)
+                       : minerReadFile(m, filename);
+    if (res < 0)
+    {
+        perror(nfile > 1 ? "merging the shards" : filename);
+        exit(EXIT_FAILURE);
+    }
+    free(files);
+    if (snapFile && minerSaveSnapshot(m, snapFile) < 0)
+    {
+        perror(snapFile);
+        exit(EXIT_FAILURE);
+    }
+    if (shardFile)
     {
-        for (int col = 0; col < nDistEvts; col++)
+        if (minerSaveSnapshot(m, shardFile) < 0)
         {
-            // printf("row = %d, col = %d\n", row, col);
-            if (row == col)
-                continue;
-
-            action_t rowEvt = distEvts[row];
-            action_t colEvt = distEvts[col];
-            if (x == 0 || y == 0)
-            {
-                x = rowEvt;
-                y = colEvt;
-                continue;
-            }
-
-            if (pd(rowEvt, colEvt, distEvts, seqMatrix) <= 70)
-                continue;
-
-            int wxy = w(x, y, distEvts, seqMatrix);
-            int wRowCol = w(rowEvt, colEvt, distEvts, seqMatrix);
-            if (wRowCol > wxy)
-            {
-                x = rowEvt;
-                y = colEvt;
-            }
+            perror(shardFile);
+            exit(EXIT_FAILURE);
         }
+        if (m->metrics)
+            fclose(m->metrics);
+        minerFree(m);
+        return 0;
     }
-    *outX = x;
-    *outY = y;
-}
 
-/* Stage 2 ----------------------------------------------------------------------------------s*/
-void get2(action_t *outX, action_t *outY, int *outType, action_t *distEvts, int nDistEvts, DF_t seqMatrix)
-{
-    action_t x = 0, y = 0;
-    int maxWeight = 0;
-    for (int row = 0; row < nDistEvts; row++)
+    cli_t cli = {0};
+    cli.verbosity = verbosity;
+    cli.ths = ths;
+    cli.nths = nths > 1 ? nths : 0;
+    outOpen(&cli.out, stdout, MAT_TEXT);
+    cli.out.names = &m->log.names;
+    cli.out.dict = &m->log.dict;
+    if (matFile)
     {
-        for (int col = 0; col < nDistEvts; col++)
+        FILE *fp = fopen(matFile, "wb");
+        if (fp == NULL)
         {
-            // printf("row = %d, col = %d\n", row, col);
-
-            action_t rowEvt = distEvts[row];
-            action_t colEvt = distEvts[col];
-            if (x == 0 || y == 0)
-            {
-                x = rowEvt;
-                y = colEvt;
-                continue;
-            }
-            if (row == col)
-                continue;
-            int supxy = sup(rowEvt, colEvt, distEvts, seqMatrix);
-            int supyx = sup(colEvt, rowEvt, distEvts, seqMatrix);
-            int max = supxy > supyx ? supxy : supyx;
-
-            // check choice pattern
-            if (max <= nDistEvts / 100)
-            {
-                int weight = nDistEvts * 100;
-                if (weight > maxWeight)
-                {
-                    maxWeight = weight;
-                    x = rowEvt;
-                    y = colEvt;
-                    *outType = 0;
-                }
-            }
-            // check candidate concurrency pattern
-            else if (supxy > 0 && supyx > 0 && pd(rowEvt, colEvt, distEvts, seqMatrix) < 30)
-            {
-
-                int weight = 100 * w(rowEvt, colEvt, distEvts, seqMatrix);
-                if (weight > maxWeight)
-                {
-                    maxWeight = weight;
-                    x = rowEvt;
-                    y = colEvt;
-                    *outType = 1;
-                }
-            }
-            else if (supxy > supyx && pd(rowEvt, colEvt, distEvts, seqMatrix) > 70)
-            {
-                int weight = w(rowEvt, colEvt, distEvts, seqMatrix);
-                if (isalpha(rowEvt) && isalpha(colEvt))
-                {
-                    weight *= 100;
-                }
-                if (weight > maxWeight)
-                {
-                    maxWeight = weight;
-                    x = rowEvt;
-                    y = colEvt;
-                    *outType = 2;
-                }
-            }
+            perror(matFile);
+            exit(EXIT_FAILURE);
         }
+        outOpen(&cli.mats, fp, matFmt);
+        cli.mats.names = &m->log.names;
+        cli.mats.dict = &m->log.dict;
     }
-    *outX = x;
-    *outY = y;
-}
-
-/* WHERE IT ALL HAPPENS ------------------------------------------------------*/
-int main(int argc, char *argv[])
-{
-#pragma region stage0
-    int size = DEFAULT_TOTAL_CAPACITY;
-    trace_t **trcs = malloc(sizeof(trace_t *) * size);
-    trcs = initTrcsFromFile(trcs, &size, "test0.txt");
-    calcTrcsFreq(trcs, size);
-    trace_t *maxTr = getMaxFreqTrace(trcs, size);
-    int nDistTrcs = countDistinctTraces(trcs, size);
 
-    // for (int i = 0; i < size; i++)
-    // {
-    //     printf("------------\n");
-    //     printTrace(trcs[i]);
-    //     printf("Freq = %d", trcs[i]->freq);
-    // }
-
-    int nEvts = countEvts(trcs, size);
-    int nDistEvts;
-    action_t *distEvts = findDistinctEvents(trcs, size, &nDistEvts);
-    int *evtFreqs = calcEvtFreq(trcs, size, distEvts, nDistEvts);
-
-    printf("==STAGE 0============================\n");
-    printf("Number of distinct events: %d\n", nDistEvts);
-    printf("Number of distinct traces: %d\n", nDistTrcs);
-    printf("Total number of events: %d\n", nEvts);
-    printf("Total number of traces: %d\n", size);
-    printf("Most frequent trace frequency: %d\n", maxTr->freq);
-    printTrace(maxTr);
-    for (int i = 0; i < nDistEvts; i++)
+    out_t *o = &cli.out;
+    if (windows)
     {
-        printf("%c = %d\n", distEvts[i], evtFreqs[i]);
+        printWindows(o, m, perBucket, bucketSecs, width);
+        outClose(&cli.out);
+        if (m->metrics)
+            fclose(m->metrics);
+        minerFree(m);
+        return 0;
     }
-#pragma endregion
-
-#pragma region stage1
-    printf("==STAGE 1============================\n");
-    int nDistEvtsInit = nDistEvts;
-    // DF_t seqMatrix;
-    int code = 256;
-    for (int i = 1; i <= nDistEvtsInit / 2; i++)
+    if (verbosity >= VERB_SUMMARY)
     {
-        int nDistEvtsi;
-
-        action_t *distEvtsi = findDistinctEvents(trcs, size, &nDistEvtsi);
-
-        int *evtFreqsi = calcEvtFreq(trcs, size, distEvtsi, nDistEvtsi);
-
-        // printf(" i = %d ndist = %d", i, nDistEvtsi);
-
-        DF_t seqMatrix = initDFMatrix(distEvtsi, nDistEvtsi, trcs, size);
-        // if (i == 3)
-        //     break;
-
-        action_t x, y;
-
-        getSeq(&x, &y, distEvtsi, nDistEvtsi, seqMatrix);
-        if (!(isalpha(x) && isalpha(y)))
-            break;
-
-        if (i != 1)
-            printf("=====================================\n");
-        printDFMatrix(seqMatrix, distEvtsi, nDistEvtsi);
-
-        replace(x, code, trcs, size);
-        replace(y, code, trcs, size);
-        int n = abstractPair(code, trcs, size);
-        for (int i = 0; i < size; i++)
-            printTrace(trcs[i]);
-        free(distEvtsi);
-        free(evtFreqsi);
-
-        distEvtsi = findDistinctEvents(trcs, size, &nDistEvtsi);
-
-        evtFreqsi = calcEvtFreq(trcs, size, distEvtsi, nDistEvtsi);
-        printf("-------------------------------------\n");
-        printf("%d = SEQ(%c,%c)\n", code, x, y);
-        printf("Number of events removed: %d\n", n);
-        for (int i = 0; i < nDistEvtsi; i++)
-        {
-            if (isalpha(distEvtsi[i]))
-                printf("%c = %d\n", distEvtsi[i], evtFreqsi[i]);
-            else
-                printf("%d = %d\n", distEvtsi[i], evtFreqsi[i]);
-        }
-        code++;
+        outStr(o, "==STAGE 0============================\n");
+        printStage0(o, m);
+        outStr(o, "==STAGE 1============================\n");
     }
-#pragma endregion
-    // for (int i = 0; i < size; i++)
-    //     printTrace(trcs[i]);
-    // return 0;
-#pragma region stage2
-    printf("==STAGE 2============================\n");
-    for (int i = 1; i <= size / 2; i++)
+    if (prefix)
+        minerUseTrie(m);
+    printStage(&cli, m, 1);
+    if (verbosity >= VERB_SUMMARY)
+        outStr(o, "==STAGE 2============================\n");
+    printStage(&cli, m, 2);
+    if (modelOut && minerSaveModel(m, modelOut) < 0)
     {
-        int nDistEvtsi;
-
-        action_t *distEvtsi = findDistinctEvents(trcs, size, &nDistEvtsi);
-
-        int *evtFreqsi = calcEvtFreq(trcs, size, distEvtsi, nDistEvtsi);
-
-        // printf(" i = %d ndist = %d", i, nDistEvtsi);
-
-        DF_t seqMatrix = initDFMatrix(distEvtsi, nDistEvtsi, trcs, size);
-        action_t x, y;
-        int pType;
-        get2(&x, &y, &pType, distEvtsi, nDistEvtsi, seqMatrix);
-
-        if (i != 1)
-            printf("=====================================\n");
-        printDFMatrix(seqMatrix, distEvtsi, nDistEvtsi);
-
-        printf("-------------------------------------\n");
-        char *typeStr;
-
-        switch (pType)
-        {
-        case 0:
-            typeStr = "CHC";
-            break;
-        case 1:
-            typeStr = "CON";
-            break;
-        case 2:
-            typeStr = "SEQ";
-        }
-        if (isalpha(x))
-        {
-            printf("%d = %s(%c,%c)\n", code, typeStr, x, y);
-        }
-        else
-        {
-            printf("%d = %s(%d,%d)\n", code, typeStr, x, y);
-        }
-        // printf("Number of events removed: %d\n", n);
-
-        replace(x, code, trcs, size);
-        replace(y, code, trcs, size);
-
-        int n = abstractPair(code, trcs, size);
-
-        // for (int i = 0; i < size; i++)
-        //     printTrace(trcs[i]);
-        // break;
-        free(distEvtsi);
-        free(evtFreqsi);
-
-        distEvtsi = findDistinctEvents(trcs, size, &nDistEvtsi);
-        evtFreqsi = calcEvtFreq(trcs, size, distEvtsi, nDistEvtsi);
+        perror(modelOut);
+        exit(EXIT_FAILURE);
+    }
 
-        printf("Number of events removed: %d\n", n);
-        for (int i = 0; i < nDistEvtsi; i++)
-        {
-            if (isalpha(distEvtsi[i]))
-                printf("%c = %d\n", distEvtsi[i], evtFreqsi[i]);
-            else
-                printf("%d = %d\n", distEvtsi[i], evtFreqsi[i]);
-        }
-        // if (i == 3)
-        //     break;
-        code++;
+    outClose(&cli.out);
+    if (matFile)
+    {
+        FILE *fp = cli.mats.fp;
+        outClose(&cli.mats);
+        fclose(fp);
     }
-#pragma endregion
-}
\ No newline at end of file
+    if (m->metrics)
+        fclose(m->metrics);
+    minerFree(m);
+    free(ths);
+}
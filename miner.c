@@ -0,0 +1,3883 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <assert.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <math.h>
+
+#include "miner.h"
+
+/* Arena ---------------------------------------------------------------------*/
+#define CHUNK_HEAD ((sizeof(chunk_t) + 15) & ~(size_t)15)
+
+// returns the size class of a block of the given bytes
+static int arenaClass(size_t bytes)
+{
+    int k = 0;
+    while (((size_t)16 << k) < bytes)
+        k++;
+    return k;
+}
+
+// returns a block of at least the given bytes, recycled from the pool of its
+// size class if possible; new chunks double in size, so a run takes only a
+// logarithmic number of blocks from malloc. Returns NULL with errno set to
+// ENOMEM if malloc fails, leaving the arena as it was
+static void *arenaAlloc(arena_t *a, size_t bytes)
+{
+    int k = arenaClass(bytes);
+    size_t size = (size_t)16 << k;
+    if (a->pools[k])
+    {
+        void *p = a->pools[k];
+        a->pools[k] = *(void **)p;
+        return p;
+    }
+    chunk_t *ch = a->chunks;
+    if (ch == NULL || ch->size - ch->used < size)
+    {
+        if (a->next == 0)
+            a->next = ARENA_CHUNK;
+        while (a->next < size)
+            a->next *= 2;
+        ch = malloc(CHUNK_HEAD + a->next);
+        if (ch == NULL)
+            return NULL;
+        ch->next = a->chunks;
+        ch->size = a->next;
+        ch->used = 0;
+        a->chunks = ch;
+        a->next *= 2;
+    }
+    void *p = (char *)ch + CHUNK_HEAD + ch->used;
+    ch->used += size;
+    return p;
+}
+
+// hands a block of the given bytes back to the pool of its size class
+static void arenaFree(arena_t *a, void *p, size_t bytes)
+{
+    if (p == NULL)
+        return;
+    int k = arenaClass(bytes);
+    *(void **)p = a->pools[k];
+    a->pools[k] = p;
+}
+
+// resizes a block from old to new bytes, keeping its contents; a block that
+// stays in its size class is not moved. Returns NULL if the arena cannot
+// grow, in which case p is left as it was
+static void *arenaGrow(arena_t *a, void *p, size_t old, size_t new)
+{
+    if (p != NULL && arenaClass(old) == arenaClass(new))
+        return p;
+    void *q = arenaAlloc(a, new);
+    if (q != NULL && p != NULL)
+    {
+        memcpy(q, p, old < new ? old : new);
+        arenaFree(a, p, old);
+    }
+    return q;
+}
+
+// releases every chunk of the arena at once
+static void freeArena(arena_t *a)
+{
+    while (a->chunks)
+    {
+        chunk_t *ch = a->chunks;
+        a->chunks = ch->next;
+        free(ch);
+    }
+    memset(a, 0, sizeof(arena_t));
+}
+
+// prepares an empty log whose arrays all come from its own arena
+static void initLog(log_t *log)
+{
+    memset(log, 0, sizeof(log_t));
+    log->dict.arena = &log->arena;
+    log->dict.firstCode = FIRST_CODE;
+    log->names.arena = &log->arena;
+}
+
+// releases all memory of the log in one call
+static void freeLog(log_t *log)
+{
+    freeArena(&log->arena);
+    initLog(log);
+}
+
+/* Activity dictionary -------------------------------------------------------*/
+
+// returns the dense index of action a, or -1 if a is not in the dictionary
+static int dictIdx(dict_t *d, action_t a)
+{
+    return a < (action_t)d->icap ? d->idx[a] : -1;
+}
+
+// returns the dense index of action a, adding it to the dictionary first if
+// it is not there yet
+static int dictAdd(dict_t *d, action_t a)
+{
+    if (a >= (action_t)d->icap)
+    {
+        int icap = d->icap ? d->icap : DEFAULT_ACTION_CAPACITY;
+        while (a >= (action_t)icap)
+            icap *= 2;
+        d->idx = arenaGrow(d->arena, d->idx, sizeof(int) * d->icap,
+                           sizeof(int) * icap);
+        for (int i = d->icap; i < icap; i++)
+            d->idx[i] = -1;
+        d->icap = icap;
+    }
+    if (d->idx[a] != -1)
+        return d->idx[a];
+    if (d->nact == d->acap)
+    {
+        int acap = d->acap ? d->acap * 2 : DEFAULT_DISTINCT_CAPACITY;
+        d->actns = arenaGrow(d->arena, d->actns, sizeof(action_t) * d->acap,
+                             sizeof(action_t) * acap);
+        d->acap = acap;
+    }
+    d->actns[d->nact] = a;
+    d->idx[a] = d->nact;
+    return d->nact++;
+}
+
+// orders actions ascending, for qsort
+static int cmpActn(const void *a, const void *b)
+{
+    action_t x = *(const action_t *)a, y = *(const action_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Name table ----------------------------------------------------------------*/
+
+// computes a hash over the bytes of a name
+static unsigned int hashName(const char *s, size_t len)
+{
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)s[i]) * 16777619u;
+    return h;
+}
+
+// doubles the slot table of the names and reinserts all of them
+static void growNameSlots(names_t *t)
+{
+    arenaFree(t->arena, t->slots, sizeof(int) * t->nslt);
+    t->nslt = t->nslt ? t->nslt * 2 : DEFAULT_SLOT_CAPACITY;
+    t->slots = arenaAlloc(t->arena, sizeof(int) * t->nslt);
+    for (int i = 0; i < t->nslt; i++)
+        t->slots[i] = -1;
+    for (int i = 0; i < t->n; i++)
+    {
+        int s = t->hashes[i] & (t->nslt - 1);
+        while (t->slots[s] != -1)
+            s = (s + 1) & (t->nslt - 1);
+        t->slots[s] = i;
+    }
+}
+
+// returns the slot holding the name made of the len bytes of s, or the empty
+// slot it would go into
+static int nameSlot(names_t *t, const char *s, size_t len, unsigned int h)
+{
+    int slot = h & (t->nslt - 1);
+    while (t->slots[slot] != -1)
+    {
+        int id = t->slots[slot];
+        const char *name = t->text + t->offs[id];
+        if (t->hashes[id] == h && strncmp(name, s, len) == 0 && name[len] == '\0')
+            return slot;
+        slot = (slot + 1) & (t->nslt - 1);
+    }
+    return slot;
+}
+
+// returns the id of the name made of the len bytes of s, or -1 if it is not
+// in the table
+static int findName(names_t *t, const char *s, size_t len)
+{
+    if (t->n == 0)
+        return -1;
+    return t->slots[nameSlot(t, s, len, hashName(s, len))];
+}
+
+// returns the id of the name made of the len bytes of s, adding a copy of it
+// to the table with the next free id if it is not there yet
+static int intern(names_t *t, const char *s, size_t len)
+{
+    if (2 * (t->n + 1) > t->nslt)
+        growNameSlots(t);
+    unsigned int h = hashName(s, len);
+    int slot = nameSlot(t, s, len, h);
+    if (t->slots[slot] != -1)
+        return t->slots[slot];
+    if (t->n == t->cap)
+    {
+        int cap = t->cap ? t->cap * 2 : DEFAULT_ACTION_CAPACITY;
+        t->offs = arenaGrow(t->arena, t->offs, sizeof(size_t) * t->cap,
+                            sizeof(size_t) * cap);
+        t->hashes = arenaGrow(t->arena, t->hashes, sizeof(unsigned int) * t->cap,
+                              sizeof(unsigned int) * cap);
+        t->cap = cap;
+    }
+    if (t->tlen + len + 1 > t->tcap)
+    {
+        size_t tcap = t->tcap ? t->tcap : DEFAULT_ACTION_CAPACITY;
+        while (t->tlen + len + 1 > tcap)
+            tcap *= 2;
+        t->text = arenaGrow(t->arena, t->text, t->tcap, tcap);
+        t->tcap = tcap;
+    }
+    memcpy(t->text + t->tlen, s, len);
+    t->text[t->tlen + len] = '\0';
+    t->offs[t->n] = t->tlen;
+    t->tlen += len + 1;
+    t->hashes[t->n] = h;
+    t->slots[slot] = t->n;
+    return t->n++;
+}
+
+// returns the name with the given id, or NULL if there is none
+const char *minerNameOf(names_t *t, action_t a)
+{
+    return a < (action_t)t->n ? t->text + t->offs[a] : NULL;
+}
+
+/* Load all the events and traces-----------------------------------------------------------------*/
+
+// loads the traces in the len bytes of buf into the store, one trace per
+// line; buf is scanned once to size the store exactly and once more to fill
+// it, and lines without any action are skipped. Returns 0, or -1 with errno
+// set to EOVERFLOW if the log has more events or traces than an int counts
+int minerLoadBuffer(store_t *st, const char *buf, size_t len)
+{
+    size_t ntrc = 0, nevt = 0;
+    int inTrace = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (buf[i] == '\n')
+            inTrace = 0;
+        else if (isalpha((unsigned char)buf[i]))
+        {
+            nevt++;
+            ntrc += !inTrace;
+            inTrace = 1;
+        }
+    }
+    if (nevt > INT_MAX || ntrc > INT_MAX)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    st->evts = malloc(sizeof(action_t) * (nevt ? nevt : 1));
+    st->trcs = malloc(sizeof(trace_t) * (ntrc ? ntrc : 1));
+    st->ecap = nevt;
+    st->tcap = ntrc;
+    st->nevt = 0;
+    st->ntrc = 0;
+    inTrace = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char ch = buf[i];
+        if (ch == '\n')
+        {
+            inTrace = 0;
+            continue;
+        }
+        if (!isalpha(ch))
+            continue;
+        if (!inTrace)
+        {
+            trace_t *tr = &st->trcs[st->ntrc++];
+            tr->head = st->nevt;
+            tr->freq = 0;
+            inTrace = 1;
+        }
+        st->trcs[st->ntrc - 1].foot = st->nevt;
+        st->evts[st->nevt++] = ch;
+    }
+    return 0;
+}
+
+// maps the whole file read-only and stores its size in len; returns the
+// mapping, an empty string if the file is empty, or NULL if it cannot be read
+static const char *mapFile(const char *filename, size_t *len)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat sb;
+    if (fstat(fd, &sb) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    *len = sb.st_size;
+    const char *buf = "";
+    if (*len > 0)
+    {
+        buf = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (buf == MAP_FAILED)
+            buf = NULL;
+        else
+            madvise((void *)buf, *len, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    return buf;
+}
+
+// releases a mapping made by mapFile
+static void unmapFile(const char *buf, size_t len)
+{
+    if (len > 0)
+        munmap((void *)buf, len);
+}
+
+// loads all the tracees from file, reading it through a read-only mapping;
+// returns 0, or -1 if the file cannot be read or is too big for the store
+static int initTrcsFromFile(store_t *st, const char *filename)
+{
+    size_t len;
+    const char *buf = mapFile(filename, &len);
+    if (buf == NULL)
+        return -1;
+    int res = minerLoadBuffer(st, buf, len);
+    unmapFile(buf, len);
+    return res;
+}
+
+// reads the CSV field that starts at buf[*pos] and leaves *pos on the comma
+// or line end after it; returns the field and stores its length in flen. A
+// quoted field may hold commas, line ends and doubled quotes, and is
+// returned unquoted in the scratch buffer
+static const char *csvField(const char *buf, size_t len, size_t *pos, size_t *flen,
+                            char **scratch, size_t *scap)
+{
+    size_t i = *pos;
+    if (i < len && buf[i] == '"')
+    {
+        size_t n = 0;
+        for (i++; i < len; i++)
+        {
+            if (buf[i] == '"')
+            {
+                if (i + 1 >= len || buf[i + 1] != '"')
+                {
+                    i++;
+                    break;
+                }
+                i++;
+            }
+            if (n == *scap)
+            {
+                *scap = *scap ? *scap * 2 : DEFAULT_EVENT_CAPACITY;
+                *scratch = realloc(*scratch, *scap);
+            }
+            (*scratch)[n++] = buf[i];
+        }
+        while (i < len && buf[i] != ',' && buf[i] != '\n')
+            i++;
+        *pos = i;
+        *flen = n;
+        return *scratch;
+    }
+    size_t from = i;
+    while (i < len && buf[i] != ',' && buf[i] != '\n')
+        i++;
+    size_t to = i;
+    if (to > from && buf[to - 1] == '\r')
+        to--;
+    *pos = i;
+    *flen = to - from;
+    return buf + from;
+}
+
+// compares two names with their ids by name
+static int cmpNames(const void *a, const void *b)
+{
+    return strcmp(((const nameId_t *)a)->name, ((const nameId_t *)b)->name);
+}
+
+// returns the names of the table with their ids in sorted name order
+static nameId_t *sortedNames(names_t *t)
+{
+    nameId_t *order = malloc(sizeof(nameId_t) * (t->n ? t->n : 1));
+    for (int i = 0; i < t->n; i++)
+        order[i] = (nameId_t){.name = minerNameOf(t, i), .id = i};
+    qsort(order, t->n, sizeof(nameId_t), cmpNames);
+    return order;
+}
+
+// parses a time field as seconds, either a number or an ISO 8601 date with
+// an optional time of day in UTC; returns NAN if it is neither
+static double parseTime(const char *s, size_t len)
+{
+    char tmp[64];
+    if (len == 0 || len >= sizeof(tmp))
+        return NAN;
+    memcpy(tmp, s, len);
+    tmp[len] = '\0';
+    char *end;
+    double v = strtod(tmp, &end);
+    if (*end == '\0')
+        return v;
+    struct tm tm = {0};
+    int n = 0;
+    if (sscanf(tmp, "%d-%d-%d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &n) != 3)
+        return NAN;
+    if (tmp[n] == 'T' || tmp[n] == ' ')
+        sscanf(tmp + n + 1, "%d:%d:%d", &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    return (double)timegm(&tm);
+}
+
+// loads the case,activity rows in the len bytes of buf into the store, one
+// trace per case in the order the cases first appear; the first row is a
+// header, the rows of a case need not be adjacent and columns after a third
+// are ignored. Activity names are interned into names in sorted order, so
+// the actions are their ids and ties break as they would for letters. If
+// times is not NULL and rows have a time in their third column, *times is
+// set to a new array of the earliest time of every case, NAN for none.
+// Returns 0, or -1 with errno set to EOVERFLOW if the log has more rows than
+// an int counts
+static int loadCsvBuffer(store_t *st, names_t *names, const char *buf, size_t len,
+                         double **times)
+{
+    double *caseTime = NULL;
+    int tcap = 0, timed = 0;
+    arena_t tmp = {0};
+    names_t caseIds = {0}, actIds = {0};
+    caseIds.arena = &tmp;
+    actIds.arena = &tmp;
+    char *scratch = NULL;
+    size_t scap = 0;
+    int *rowCase = NULL;
+    action_t *rowAct = NULL;
+    int nrow = 0, full = 0;
+    size_t rcap = 0;
+    int header = 1;
+    size_t pos = 0;
+    while (pos < len && !full)
+    {
+        if (buf[pos] == '\n' || buf[pos] == '\r')
+        {
+            pos++;
+            continue;
+        }
+        size_t clen, alen = 0;
+        const char *c = csvField(buf, len, &pos, &clen, &scratch, &scap);
+        int id = -1;
+        if (!header && clen > 0)
+            id = intern(&caseIds, c, clen);
+        const char *a = NULL;
+        if (pos < len && buf[pos] == ',')
+        {
+            pos++;
+            a = csvField(buf, len, &pos, &alen, &scratch, &scap);
+        }
+        full = id >= 0 && alen > 0 && nrow == INT_MAX;
+        if (id >= 0 && alen > 0 && !full)
+        {
+            if ((size_t)nrow == rcap)
+            {
+                rcap = rcap ? rcap * 2 : DEFAULT_EVENT_CAPACITY;
+                rowCase = realloc(rowCase, sizeof(int) * rcap);
+                rowAct = realloc(rowAct, sizeof(action_t) * rcap);
+            }
+            rowCase[nrow] = id;
+            rowAct[nrow++] = intern(&actIds, a, alen);
+        }
+        if (times && id >= 0 && pos < len && buf[pos] == ',')
+        {
+            size_t tlen;
+            pos++;
+            const char *s = csvField(buf, len, &pos, &tlen, &scratch, &scap);
+            double t = parseTime(s, tlen);
+            if (id >= tcap)
+            {
+                int cap = tcap ? tcap : DEFAULT_EVENT_CAPACITY;
+                while (id >= cap)
+                    cap *= 2;
+                caseTime = realloc(caseTime, sizeof(double) * cap);
+                for (int i = tcap; i < cap; i++)
+                    caseTime[i] = NAN;
+                tcap = cap;
+            }
+            if (!isnan(t) && (isnan(caseTime[id]) || t < caseTime[id]))
+                caseTime[id] = t;
+            timed |= !isnan(t);
+        }
+        header = 0;
+        while (pos < len && buf[pos] != '\n')
+            pos++;
+    }
+    if (full)
+    {
+        free(caseTime);
+        free(rowCase);
+        free(rowAct);
+        free(scratch);
+        freeArena(&tmp);
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    nameId_t *order = sortedNames(&actIds);
+    action_t *map = malloc(sizeof(action_t) * (actIds.n ? actIds.n : 1));
+    for (int i = 0; i < actIds.n; i++)
+        map[order[i].id] = intern(names, order[i].name, strlen(order[i].name));
+    for (int r = 0; r < nrow; r++)
+        rowAct[r] = map[rowAct[r]];
+    free(order);
+    free(map);
+
+    st->ntrc = st->tcap = caseIds.n;
+    st->nevt = st->ecap = nrow;
+    st->trcs = calloc(st->ntrc ? st->ntrc : 1, sizeof(trace_t));
+    st->evts = malloc(sizeof(action_t) * (nrow ? nrow : 1));
+    for (int r = 0; r < nrow; r++)
+        st->trcs[rowCase[r]].freq++;
+    int head = 0;
+    for (int i = 0; i < st->ntrc; i++)
+    {
+        trace_t *tr = &st->trcs[i];
+        tr->head = head;
+        tr->foot = head - 1;
+        head += tr->freq;
+        tr->freq = 0;
+    }
+    for (int r = 0; r < nrow; r++)
+        st->evts[++st->trcs[rowCase[r]].foot] = rowAct[r];
+    if (times)
+    {
+        *times = NULL;
+        if (timed)
+        {
+            caseTime = realloc(caseTime, sizeof(double) * (caseIds.n ? caseIds.n : 1));
+            for (int i = tcap; i < caseIds.n; i++)
+                caseTime[i] = NAN;
+            *times = caseTime;
+            caseTime = NULL;
+        }
+    }
+    free(caseTime);
+
+    free(rowCase);
+    free(rowAct);
+    free(scratch);
+    freeArena(&tmp);
+    return 0;
+}
+
+// releases the events and traces held by the store
+void minerFreeStore(store_t *st)
+{
+    free(st->evts);
+    free(st->trcs);
+    *st = (store_t){0};
+}
+
+/* Parallel counting ---------------------------------------------------------*/
+
+// orders cells by row and then by column, for qsort
+static int cmpCell(const void *a, const void *b)
+{
+    const dfcell_t *p = a, *q = b;
+    if (p->row != q->row)
+        return p->row < q->row ? -1 : 1;
+    return (p->col > q->col) - (p->col < q->col);
+}
+
+// runs fn on each of the n argument blocks of args, the first on the calling
+// thread and every other one on a thread of its own, and waits for all of them
+static void runWorkers(void *(*fn)(void *), void *args, size_t argSize, int n)
+{
+    pthread_t *tids = malloc(sizeof(pthread_t) * n);
+    for (int k = 1; k < n; k++)
+        pthread_create(&tids[k], NULL, fn, (char *)args + k * argSize);
+    fn(args);
+    for (int k = 1; k < n; k++)
+        pthread_join(tids[k], NULL);
+    free(tids);
+}
+
+// counts the events, the event frequencies and, if asked for, the directly
+// follows pairs of one share of the log
+static void *countPart(void *arg)
+{
+    part_t *pt = arg;
+    log_t *log = pt->log;
+    int *idx = log->dict.idx;
+    if (pt->size)
+    {
+        pt->evtFreqs = calloc(pt->size, sizeof(count_t));
+        if (pt->wantDF && !pt->sparse)
+            pt->matrix = calloc((size_t)pt->size * pt->size, sizeof(count_t));
+    }
+    for (int i = pt->from; i < pt->to; i++)
+    {
+        trace_t *tr = &log->trcs[i];
+        pt->nEvts += (count_t)(tr->foot - tr->head + 1) * tr->freq;
+        if (!pt->size)
+            continue;
+        for (int cur = tr->head; cur <= tr->foot; cur++)
+        {
+            int row = idx[log->evts[cur]];
+            pt->evtFreqs[row] += tr->freq;
+            if (!pt->wantDF || cur == tr->foot)
+                continue;
+            int col = idx[log->evts[cur + 1]];
+            if (!pt->sparse)
+            {
+                pt->matrix[(size_t)row * pt->size + col] += tr->freq;
+                continue;
+            }
+            if (pt->ncell == pt->ccap)
+            {
+                pt->ccap = pt->ccap ? pt->ccap * 2 : DEFAULT_EVENT_CAPACITY;
+                pt->cells = realloc(pt->cells, sizeof(dfcell_t) * pt->ccap);
+            }
+            pt->cells[pt->ncell++] = (dfcell_t){row, col, tr->freq};
+        }
+    }
+
+    if (pt->ncell)
+    {
+        qsort(pt->cells, pt->ncell, sizeof(dfcell_t), cmpCell);
+        int n = 0;
+        for (int c = 1; c < pt->ncell; c++)
+        {
+            if (cmpCell(&pt->cells[n], &pt->cells[c]) == 0)
+                pt->cells[n].cnt += pt->cells[c].cnt;
+            else
+                pt->cells[++n] = pt->cells[c];
+        }
+        pt->ncell = n + 1;
+    }
+    return NULL;
+}
+
+// splits the distinct traces of the log into threads shares of about the
+// same number of events and counts them in parallel; the caller merges the
+// returned shares and releases them with freeParts
+static part_t *countLog(log_t *log, int size, int wantDF, int sparse, int threads,
+                        int *nParts)
+{
+    int n = threads < 1 ? 1 : threads;
+    if (n > log->ndtr)
+        n = log->ndtr ? log->ndtr : 1;
+    part_t *parts = calloc(n, sizeof(part_t));
+    int from = 0;
+    for (int k = 0; k < n; k++)
+    {
+        count_t until = (count_t)log->nevt * (k + 1) / n;
+        int to = from;
+        while (to < log->ndtr && (k == n - 1 || log->trcs[to].head < until))
+            to++;
+        parts[k] = (part_t){.log = log, .from = from, .to = to, .size = size,
+                            .wantDF = wantDF, .sparse = sparse};
+        from = to;
+    }
+
+    runWorkers(countPart, parts, sizeof(part_t), n);
+    *nParts = n;
+    return parts;
+}
+
+// releases the shares of a counting pass
+static void freeParts(part_t *parts, int nParts)
+{
+    for (int k = 0; k < nParts; k++)
+    {
+        free(parts[k].matrix);
+        free(parts[k].cells);
+        free(parts[k].evtFreqs);
+    }
+    free(parts);
+}
+
+/* Stage 0 -------------------------------------------------------------------------------------*/
+
+// find all the distinct events in the given traces
+action_t *minerFindDistinctEvents(log_t *log, int *nDistEvts)
+{
+    dict_t *d = &log->dict;
+    char *seen = calloc(d->nact ? d->nact : 1, sizeof(char));
+    int nDist = 0;
+    for (int i = 0; i < log->nevt; i++)
+    {
+        int j = d->idx[log->evts[i]];
+        nDist += !seen[j];
+        seen[j] = 1;
+    }
+
+    action_t *distEvts = malloc(sizeof(action_t) * (nDist ? nDist : 1));
+    nDist = 0;
+    for (int j = 0; j < d->nact; j++)
+    {
+        if (seen[j])
+            distEvts[nDist++] = d->actns[j];
+    }
+    free(seen);
+    qsort(distEvts, nDist, sizeof(action_t), cmpActn);
+    *nDistEvts = nDist;
+    return distEvts;
+}
+
+// counts the total number of events in the given tracecs on the given
+// number of threads
+static count_t countEvts(log_t *log, int threads)
+{
+    int nParts;
+    part_t *parts = countLog(log, 0, 0, 0, threads, &nParts);
+    count_t nEvts = 0;
+    for (int k = 0; k < nParts; k++)
+    {
+        nEvts += parts[k].nEvts;
+    }
+    freeParts(parts, nParts);
+    return nEvts;
+}
+
+// calculates the frequencies of all the events in the given traces
+// returns an array of frequencies.
+// The index of frequency in the returned array corresponds to the event's
+// index in lexicographical order. The log is counted on the given number
+// of threads
+count_t *minerCalcEvtFreq(log_t *log, action_t *actns, int nDistEvts, int threads)
+{
+    dict_t *d = &log->dict;
+    count_t *dictFreqs = calloc(d->nact ? d->nact : 1, sizeof(count_t));
+    int nParts;
+    part_t *parts = countLog(log, d->nact, 0, 0, threads, &nParts);
+    for (int k = 0; k < nParts; k++)
+    {
+        for (int j = 0; j < d->nact; j++)
+            dictFreqs[j] += parts[k].evtFreqs[j];
+    }
+    freeParts(parts, nParts);
+
+    count_t *evtFreqs = malloc(sizeof(count_t) * nDistEvts);
+    for (int j = 0; j < nDistEvts; j++)
+    {
+        int k = dictIdx(d, actns[j]);
+        evtFreqs[j] = k < 0 ? 0 : dictFreqs[k];
+    }
+    free(dictFreqs);
+    return evtFreqs;
+}
+
+// checks whether two traces, given as runs of actions, are equal
+static int equals(action_t *tr1, int len1, action_t *tr2, int len2)
+{
+    if (len1 != len2)
+        return 0;
+    return memcmp(tr1, tr2, sizeof(action_t) * len1) == 0;
+}
+
+// computes a rolling hash over the actions of a trace
+static unsigned int hashTrace(action_t *actns, int len)
+{
+    unsigned int h = 2166136261u;
+    for (int i = 0; i < len; i++)
+    {
+        h = (h ^ actns[i]) * 16777619u;
+    }
+    return h;
+}
+
+// doubles the slot table of the log and reinserts all distinct traces;
+// returns 0, or -1 if the arena cannot grow, keeping the old table
+static int growSlots(log_t *log)
+{
+    int nslt = log->nslt ? log->nslt * 2 : DEFAULT_SLOT_CAPACITY;
+    int *slots = arenaAlloc(&log->arena, sizeof(int) * nslt);
+    if (slots == NULL)
+        return -1;
+    arenaFree(&log->arena, log->slots, sizeof(int) * log->nslt);
+    log->slots = slots;
+    log->nslt = nslt;
+    for (int i = 0; i < log->nslt; i++)
+        log->slots[i] = -1;
+    for (int i = 0; i < log->ndtr; i++)
+    {
+        int s = log->hashes[i] & (log->nslt - 1);
+        while (log->slots[s] != -1)
+            s = (s + 1) & (log->nslt - 1);
+        log->slots[s] = i;
+    }
+    return 0;
+}
+
+// returns the index of the distinct trace made of the given actions, adding
+// a copy of them to the log as a new distinct trace with frequency 0 if they
+// were not seen before; returns -1 if the arena cannot hold the copy
+static int findVariant(log_t *log, action_t *actns, int len)
+{
+    if (2 * (log->ndtr + 1) > log->nslt && growSlots(log) < 0)
+        return -1;
+    unsigned int h = hashTrace(actns, len);
+    int s = h & (log->nslt - 1);
+    while (log->slots[s] != -1)
+    {
+        int v = log->slots[s];
+        trace_t *tr = &log->trcs[v];
+        if (log->hashes[v] == h &&
+            equals(log->evts + tr->head, tr->foot - tr->head + 1, actns, len))
+            return v;
+        s = (s + 1) & (log->nslt - 1);
+    }
+    if (log->ndtr == log->cpct)
+    {
+        int cpct = log->cpct ? log->cpct * 2 : DEFAULT_DISTINCT_CAPACITY;
+        trace_t *trcs = arenaGrow(&log->arena, log->trcs,
+                                  sizeof(trace_t) * log->cpct, sizeof(trace_t) * cpct);
+        unsigned int *hashes = trcs == NULL ? NULL
+                               : arenaGrow(&log->arena, log->hashes,
+                                           sizeof(unsigned int) * log->cpct,
+                                           sizeof(unsigned int) * cpct);
+        if (hashes == NULL)
+        {
+            // trcs may have moved already; cpct only grows with both
+            log->trcs = trcs ? trcs : log->trcs;
+            return -1;
+        }
+        log->trcs = trcs;
+        log->hashes = hashes;
+        log->cpct = cpct;
+    }
+    if (log->nevt + len > log->ecap)
+    {
+        int ecap = log->ecap ? log->ecap : DEFAULT_EVENT_CAPACITY;
+        while (log->nevt + len > ecap)
+            ecap = ecap > INT_MAX / 2 ? INT_MAX : ecap * 2;
+        action_t *evts = arenaGrow(&log->arena, log->evts,
+                                   sizeof(action_t) * log->ecap, sizeof(action_t) * ecap);
+        if (evts == NULL)
+            return -1;
+        log->evts = evts;
+        log->ecap = ecap;
+    }
+    memcpy(log->evts + log->nevt, actns, sizeof(action_t) * len);
+    for (int i = 0; i < len; i++)
+        dictAdd(&log->dict, actns[i]);
+    trace_t *tr = &log->trcs[log->ndtr];
+    tr->head = log->nevt;
+    tr->foot = log->nevt + len - 1;
+    tr->freq = 0;
+    log->nevt += len;
+    log->hashes[log->ndtr] = h;
+    log->slots[s] = log->ndtr;
+    return log->ndtr++;
+}
+
+// counts all the distinct traces in the given log
+static int countDistinctTraces(log_t *log)
+{
+    return log->ndtr;
+}
+
+// calculates the frequencies of the given traces
+//  fills the log with a single copy of every distinct trace of the store,
+//  weighted by its frequency, and records the distinct trace of every case;
+//  returns 0, or -1 with errno set to ENOMEM if the log cannot hold them
+int minerCalcTrcsFreq(log_t *log, store_t *st)
+{
+    log->cases = arenaAlloc(&log->arena, sizeof(int) * (st->ntrc ? st->ntrc : 1));
+    if (log->cases == NULL)
+        return -1;
+    for (int i = 0; i < st->ntrc; i++)
+    {
+        trace_t *tr = &st->trcs[i];
+        int v = findVariant(log, st->evts + tr->head, tr->foot - tr->head + 1);
+        if (v < 0)
+            return -1;
+        log->trcs[v].freq++;
+        log->cases[i] = v;
+        log->ncas++;
+    }
+    return 0;
+}
+
+// returns the trace with the maximum frequency
+static trace_t *getMaxFreqTrace(log_t *log)
+{
+    trace_t *maxTr = NULL;
+    for (int i = 0; i < log->ndtr; i++)
+    {
+        if (maxTr == NULL || log->trcs[i].freq > maxTr->freq)
+        {
+            maxTr = &log->trcs[i];
+        }
+    }
+    return maxTr;
+}
+
+/* Directly follows engine --------------------------------------------------*/
+
+// returns how often the action with dense index row is directly followed by
+// the one with dense index col
+static count_t dfGet(df_t *df, int row, int col)
+{
+    if (!df->sparse)
+        return df->matrix[(size_t)row * df->stride + col];
+    int lo = df->rowPtr[row], hi = df->rowPtr[row + 1] - 1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (df->cols[mid] == col)
+            return df->vals[mid];
+        if (df->cols[mid] < col)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return 0;
+}
+
+// adds cnt to the given cell; in CSR form the change stays pending until the
+// next dfCommit
+static void dfAdd(df_t *df, int row, int col, count_t cnt)
+{
+    if (!df->sparse)
+    {
+        df->matrix[(size_t)row * df->stride + col] += cnt;
+        return;
+    }
+    if (df->npnd == df->pcap)
+    {
+        df->pcap = df->pcap ? df->pcap * 2 : DEFAULT_EVENT_CAPACITY;
+        df->pend = realloc(df->pend, sizeof(dfcell_t) * df->pcap);
+    }
+    df->pend[df->npnd++] = (dfcell_t){row, col, cnt};
+}
+
+// merges the pending changes into the CSR rows, dropping cells that reach 0
+static void dfCommit(df_t *df)
+{
+    if (!df->sparse || df->npnd == 0)
+        return;
+    qsort(df->pend, df->npnd, sizeof(dfcell_t), cmpCell);
+    int cap = df->nnz + df->npnd;
+    int *rowPtr = malloc(sizeof(int) * (df->cpct + 1));
+    int *cols = malloc(sizeof(int) * cap);
+    count_t *vals = malloc(sizeof(count_t) * cap);
+    int nnz = 0, p = 0;
+    for (int r = 0; r < df->size; r++)
+    {
+        rowPtr[r] = nnz;
+        int c = df->rowPtr[r], end = df->rowPtr[r + 1];
+        while (c < end || (p < df->npnd && df->pend[p].row == r))
+        {
+            int pc = p < df->npnd && df->pend[p].row == r ? df->pend[p].col : df->size;
+            int cc = c < end ? df->cols[c] : df->size;
+            int col = pc < cc ? pc : cc;
+            count_t cnt = 0;
+            if (cc == col)
+                cnt += df->vals[c++];
+            while (p < df->npnd && df->pend[p].row == r && df->pend[p].col == col)
+                cnt += df->pend[p++].cnt;
+            if (cnt != 0)
+            {
+                cols[nnz] = col;
+                vals[nnz++] = cnt;
+            }
+        }
+    }
+    rowPtr[df->size] = nnz;
+    free(df->rowPtr);
+    free(df->cols);
+    free(df->vals);
+    df->rowPtr = rowPtr;
+    df->cols = cols;
+    df->vals = vals;
+    df->nnz = nnz;
+    df->npnd = 0;
+}
+
+// makes room in the engine for every action of its dictionary
+static void growDF(df_t *df)
+{
+    int size = df->dict->nact;
+    if (size > df->cpct)
+    {
+        int cpct = df->cpct ? df->cpct : DEFAULT_DISTINCT_CAPACITY;
+        while (cpct < size)
+            cpct *= 2;
+        if (df->sparse)
+        {
+            df->rowPtr = realloc(df->rowPtr, sizeof(int) * (cpct + 1));
+        }
+        else
+        {
+            int lineCnts = CACHE_LINE / sizeof(count_t);
+            int stride = (cpct + lineCnts - 1) / lineCnts * lineCnts;
+            DF_t matrix = aligned_alloc(CACHE_LINE, sizeof(count_t) * stride * stride);
+            memset(matrix, 0, sizeof(count_t) * stride * stride);
+            for (int r = 0; r < df->size; r++)
+                memcpy(matrix + (size_t)r * stride, df->matrix + (size_t)r * df->stride,
+                       sizeof(count_t) * df->size);
+            free(df->matrix);
+            df->matrix = matrix;
+            df->stride = stride;
+        }
+        df->evtFreqs = realloc(df->evtFreqs, sizeof(count_t) * cpct);
+        memset(df->evtFreqs + df->cpct, 0, sizeof(count_t) * (cpct - df->cpct));
+        df->cpct = cpct;
+    }
+    if (df->sparse)
+    {
+        for (int r = df->size; r < size; r++)
+            df->rowPtr[r + 1] = df->nnz;
+    }
+    df->size = size;
+}
+
+// releases everything held by the engine
+static void freeDF(df_t *df)
+{
+    free(df->matrix);
+    free(df->rowPtr);
+    free(df->cols);
+    free(df->vals);
+    free(df->pend);
+    free(df->evtFreqs);
+    free(df->live);
+    free(df->touched);
+    *df = (df_t){0};
+}
+
+// empties the engine, keeping its thread count, and binds it to the log,
+// in CSR form if the log has more than DF_DENSE_LIMIT actions
+static void dfReset(df_t *df, log_t *log)
+{
+    int threads = df->threads;
+    freeDF(df);
+    df->threads = threads;
+    df->dict = &log->dict;
+    df->sparse = df->dict->nact > DF_DENSE_LIMIT;
+    if (df->sparse)
+    {
+        df->rowPtr = calloc(1, sizeof(int));
+    }
+    growDF(df);
+}
+
+// moves a dense engine over to CSR form
+static void dfToSparse(df_t *df)
+{
+    for (int r = 0; r < df->size; r++)
+    {
+        for (int c = 0; c < df->size; c++)
+        {
+            count_t cnt = df->matrix[(size_t)r * df->stride + c];
+            if (cnt != 0)
+            {
+                df->sparse = 1;
+                dfAdd(df, r, c, cnt);
+                df->sparse = 0;
+            }
+        }
+    }
+    free(df->matrix);
+    df->matrix = NULL;
+    df->stride = 0;
+    df->sparse = 1;
+    df->rowPtr = calloc(df->cpct + 1, sizeof(int));
+    df->nnz = 0;
+    dfCommit(df);
+}
+
+// collects the actions still in the log once its counts are complete
+static void dfSettle(df_t *df, log_t *log)
+{
+    dfCommit(df);
+    df->live = realloc(df->live, sizeof(action_t) * (df->size ? df->size : 1));
+    df->nlive = 0;
+    for (int j = 0; j < df->size; j++)
+    {
+        if (df->evtFreqs[j] > 0)
+            df->live[df->nlive++] = df->dict->actns[j];
+    }
+    qsort(df->live, df->nlive, sizeof(action_t), cmpActn);
+    df->touched = realloc(df->touched, sizeof(int) * (log->ndtr ? log->ndtr : 1));
+}
+
+// Initializes the directly follows matrix and the event frequencies of the
+// engine from scratch, in CSR form if the log has more than DF_DENSE_LIMIT
+// actions; the log is counted by df->threads threads whose thread-local counts
+// are summed afterwards
+void minerInitDFMatrix(df_t *df, log_t *log)
+{
+    dfReset(df, log);
+
+    int nParts;
+    part_t *parts = countLog(log, df->size, 1, df->sparse, df->threads, &nParts);
+    for (int k = 0; k < nParts; k++)
+    {
+        part_t *pt = &parts[k];
+        for (int r = 0; r < df->size; r++)
+        {
+            df->evtFreqs[r] += pt->evtFreqs[r];
+            if (df->sparse)
+                continue;
+            count_t *dst = df->matrix + (size_t)r * df->stride;
+            count_t *src = pt->matrix + (size_t)r * df->size;
+            for (int c = 0; c < df->size; c++)
+                dst[c] += src[c];
+        }
+        for (int c = 0; c < pt->ncell; c++)
+            dfAdd(df, pt->cells[c].row, pt->cells[c].col, pt->cells[c].cnt);
+    }
+    freeParts(parts, nParts);
+    dfSettle(df, log);
+}
+
+// commits the directly follows pairs rewriteLog or rewriteTrie moved over to
+// code and moves the frequencies of x and y over to it, once n events have
+// been removed by abstracting the pair
+static void dfLink(df_t *df, action_t x, action_t y, action_t code, count_t n)
+{
+    int *idx = df->dict->idx;
+    dfCommit(df);
+    df->evtFreqs[idx[code]] = df->evtFreqs[idx[x]] + df->evtFreqs[idx[y]] - n;
+    df->evtFreqs[idx[x]] = 0;
+    df->evtFreqs[idx[y]] = 0;
+
+    int nlive = 0;
+    for (int j = 0; j < df->nlive; j++)
+    {
+        if (df->live[j] != x && df->live[j] != y)
+            df->live[nlive++] = df->live[j];
+    }
+    df->live = realloc(df->live, sizeof(action_t) * df->size);
+    int j = nlive++;
+    while (j > 0 && df->live[j - 1] > code)
+    {
+        df->live[j] = df->live[j - 1];
+        j--;
+    }
+    df->live[j] = code;
+    df->nlive = nlive;
+}
+
+// commits the directly follows pairs rewriteLog or rewriteTrie moved over to
+// the codes of the k folded patterns and moves the frequencies of their
+// operands over to them; the codes must be consecutive
+static void dfLinkSet(df_t *df, node_t *nds, int k)
+{
+    int *idx = df->dict->idx;
+    dfCommit(df);
+    for (int i = 0; i < k; i++)
+    {
+        int x = idx[nds[i].x], y = idx[nds[i].y];
+        df->evtFreqs[idx[nds[i].code]] = df->evtFreqs[x] + df->evtFreqs[y] - nds[i].removed;
+        df->evtFreqs[x] = 0;
+        df->evtFreqs[y] = 0;
+    }
+
+    // the codes are the largest actions, so they go to the end in order
+    int nlive = 0;
+    for (int j = 0; j < df->nlive; j++)
+    {
+        if (df->evtFreqs[idx[df->live[j]]] > 0)
+            df->live[nlive++] = df->live[j];
+    }
+    df->live = realloc(df->live, sizeof(action_t) * df->size);
+    for (int i = 0; i < k; i++)
+        df->live[nlive++] = nds[i].code;
+    df->nlive = nlive;
+}
+
+/* Streaming -----------------------------------------------------------------*/
+
+// folds one trace, given as its actions, into the directly follows counts
+// and event frequencies of the engine freq times
+static void dfAddTrace(df_t *df, action_t *actns, int len, count_t freq)
+{
+    growDF(df);
+    if (!df->sparse && df->size > DF_DENSE_LIMIT)
+        dfToSparse(df);
+    int *idx = df->dict->idx;
+    for (int i = 0; i < len; i++)
+    {
+        df->evtFreqs[idx[actns[i]]] += freq;
+        if (i + 1 < len)
+            dfAdd(df, idx[actns[i]], idx[actns[i + 1]], freq);
+    }
+    if (df->npnd > PENDING_LIMIT)
+        dfCommit(df);
+}
+
+// folds one case into the variant table of the log and the counts of df;
+// returns 0, or -1 with errno set to EOVERFLOW if the log cannot count
+// another case or might not hold its events, or to ENOMEM if it cannot grow
+static int addCase(log_t *log, df_t *df, action_t *actns, int len)
+{
+    if (log->ncas == INT_MAX || len > INT_MAX - log->nevt)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    int v = findVariant(log, actns, len);
+    if (v < 0)
+        return -1;
+    log->trcs[v].freq++;
+    log->ncas++;
+    dfAddTrace(df, actns, len, 1);
+    return 0;
+}
+
+/* Live logs -----------------------------------------------------------------*/
+
+// makes room in the live log for the case with the given id
+static void growLive(live_t *lv, int id)
+{
+    if (id < lv->size)
+        return;
+    int size = lv->size ? lv->size : DEFAULT_EVENT_CAPACITY;
+    while (id >= size)
+        size *= 2;
+    lv->evts = realloc(lv->evts, sizeof(action_t *) * size);
+    lv->len = realloc(lv->len, sizeof(int) * size);
+    lv->cap = realloc(lv->cap, sizeof(int) * size);
+    for (int i = lv->size; i < size; i++)
+    {
+        lv->evts[i] = NULL;
+        lv->len[i] = -1;
+        lv->cap[i] = 0;
+    }
+    lv->size = size;
+}
+
+// drops the ids of the closed cases, moving the open ones to new ids
+static void compactLive(live_t *lv)
+{
+    arena_t arena = {0};
+    names_t ids = {0};
+    ids.arena = &arena;
+    int n = lv->ids.n;
+    for (int i = 0; i < n; i++)
+    {
+        if (lv->len[i] < 0)
+            continue;
+        const char *s = minerNameOf(&lv->ids, i);
+        int id = intern(&ids, s, strlen(s));
+        lv->evts[id] = lv->evts[i];
+        lv->len[id] = lv->len[i];
+        lv->cap[id] = lv->cap[i];
+    }
+    for (int i = ids.n; i < n; i++)
+    {
+        lv->evts[i] = NULL;
+        lv->len[i] = -1;
+        lv->cap[i] = 0;
+    }
+    freeArena(&lv->arena);
+    lv->arena = arena;
+    lv->ids = ids;
+    lv->ids.arena = &lv->arena;
+}
+
+// prepares an empty live log that feeds the cases it completes into the
+// empty miner m
+void minerInitLive(live_t *lv, miner_t *m)
+{
+    memset(lv, 0, sizeof(live_t));
+    lv->ids.arena = &lv->arena;
+    dfReset(&m->df, &m->log);
+}
+
+// takes one case,activity line: the activity is appended to its case, and a
+// line without an activity completes the case, which is then folded into
+// the variants and the DF counts of m; activities are named. Returns 0, or
+// -1 with errno set to EOVERFLOW if the case is dropped as the log is full
+int minerLiveLine(live_t *lv, miner_t *m, const char *line, size_t len)
+{
+    size_t pos = 0, clen, alen = 0;
+    const char *c = csvField(line, len, &pos, &clen, &lv->scratch, &lv->scap);
+    if (clen == 0)
+        return 0;
+    int id = intern(&lv->ids, c, clen);
+    growLive(lv, id);
+    if (pos < len && line[pos] == ',')
+    {
+        pos++;
+        const char *a = csvField(line, len, &pos, &alen, &lv->scratch, &lv->scap);
+        if (alen > 0)
+        {
+            names_t *names = &m->log.names;
+            action_t act = intern(names, a, alen);
+            if ((action_t)names->n > m->log.dict.firstCode)
+                m->log.dict.firstCode = names->n;
+            if (lv->len[id] < 0)
+            {
+                lv->len[id] = 0;
+                lv->nopen++;
+            }
+            if (lv->len[id] == lv->cap[id])
+            {
+                lv->cap[id] = lv->cap[id] ? lv->cap[id] * 2 : DEFAULT_DISTINCT_CAPACITY;
+                lv->evts[id] = realloc(lv->evts[id], sizeof(action_t) * lv->cap[id]);
+            }
+            lv->evts[id][lv->len[id]++] = act;
+            return 0;
+        }
+    }
+    if (lv->len[id] < 0)
+        return 0;
+    int res = addCase(&m->log, &m->df, lv->evts[id], lv->len[id]);
+    free(lv->evts[id]);
+    lv->evts[id] = NULL;
+    lv->len[id] = -1;
+    lv->cap[id] = 0;
+    lv->nopen--;
+    if (lv->ids.n - lv->nopen > lv->nopen + LIVE_SLACK)
+        compactLive(lv);
+    return res;
+}
+
+// releases the open cases of the live log
+void minerFreeLive(live_t *lv)
+{
+    for (int i = 0; i < lv->size; i++)
+        free(lv->evts[i]);
+    free(lv->evts);
+    free(lv->len);
+    free(lv->cap);
+    free(lv->scratch);
+    freeArena(&lv->arena);
+    memset(lv, 0, sizeof(live_t));
+}
+
+// reads the log from file in chunks of STREAM_CHUNK bytes, folding every
+// trace straight into the variant table of the log and into df as soon as
+// its line ends; only the current trace is kept apart from the distinct
+// traces, so memory depends on the variants and actions, not on the cases;
+// returns 0, or -1 if the file cannot be read or, with errno set to
+// EOVERFLOW, holds more than an int counts
+static int streamTrcsFromFile(log_t *log, df_t *df, const char *filename)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return -1;
+
+    dfReset(df, log);
+    char *chunk = malloc(STREAM_CHUNK);
+    action_t *cur = malloc(sizeof(action_t) * DEFAULT_EVENT_CAPACITY);
+    int len = 0, cap = DEFAULT_EVENT_CAPACITY, res = 0;
+    size_t n;
+    while (res == 0 && (n = fread(chunk, 1, STREAM_CHUNK, fp)) > 0)
+    {
+        for (size_t i = 0; res == 0 && i < n; i++)
+        {
+            unsigned char ch = chunk[i];
+            if (ch == '\n')
+            {
+                if (len)
+                    res = addCase(log, df, cur, len);
+                len = 0;
+            }
+            else if (isalpha(ch))
+            {
+                if (len == INT_MAX)
+                {
+                    errno = EOVERFLOW;
+                    res = -1;
+                    break;
+                }
+                if (len == cap)
+                {
+                    cap = cap > INT_MAX / 2 ? INT_MAX : cap * 2;
+                    cur = realloc(cur, sizeof(action_t) * cap);
+                }
+                cur[len++] = ch;
+            }
+        }
+    }
+    if (res == 0 && len)
+        res = addCase(log, df, cur, len);
+    fclose(fp);
+    free(chunk);
+    free(cur);
+    dfSettle(df, log);
+    return res;
+}
+
+// applies the k rules in one sweep over the contiguous events: every event
+// of x or y of a rule is relabelled to its code, and a run of adjacent events
+// of the same new code is collapsed into one, compacting the log in place;
+// the codes must be consecutive and new to the log. The same sweep moves the
+// directly follows pairs of the operands in df over to the codes, left
+// pending for dfLink, and remembers the distinct traces it changed. Fills in
+// the events each rule removed and returns the events removed in total
+static count_t rewriteLog(log_t *log, df_t *df, node_t *rules, int k)
+{
+    if (k <= 0)
+        return 0;
+    action_t lo = rules[0].code;
+    action_t *codeOf = calloc(log->dict.nact + k, sizeof(action_t));
+    for (int i = 0; i < k; i++)
+    {
+        codeOf[log->dict.idx[rules[i].x]] = rules[i].code;
+        codeOf[log->dict.idx[rules[i].y]] = rules[i].code;
+        rules[i].removed = 0;
+    }
+    for (int i = 0; i < k; i++)
+        dictAdd(&log->dict, rules[i].code);
+    growDF(df);
+
+    int *idx = log->dict.idx;
+    action_t *evts = log->evts;
+    count_t total = 0;
+    int dst = 0;
+    df->ntch = 0;
+    for (int i = 0; i < log->ndtr; i++)
+    {
+        trace_t *tr = &log->trcs[i];
+        int head = dst, found = 0;
+        action_t last = 0; // the code of the last event written, if any
+        for (int src = tr->head; src <= tr->foot; src++)
+        {
+            action_t a = evts[src];
+            action_t z = codeOf[idx[a]];
+            found |= z != 0;
+            // dst never passes src, so the old pair is still in place
+            if (src < tr->foot && (z || codeOf[idx[evts[src + 1]]]))
+                dfAdd(df, idx[a], idx[evts[src + 1]], -tr->freq);
+            if (z)
+            {
+                if (dst > head && evts[dst - 1] == z)
+                {
+                    rules[z - lo].removed += tr->freq;
+                    total += tr->freq;
+                    continue;
+                }
+                a = z;
+            }
+            if (dst > head && (z || last))
+                dfAdd(df, idx[evts[dst - 1]], idx[a], tr->freq);
+            last = z;
+            evts[dst++] = a;
+        }
+        if (found)
+            df->touched[df->ntch++] = i;
+        tr->head = head;
+        tr->foot = dst - 1;
+    }
+    log->nevt = dst;
+    free(codeOf);
+    return total;
+}
+
+/* Prefix tree ---------------------------------------------------------------*/
+
+// makes room for one more node in the prefix tree
+static void growTrie(trie_t *t)
+{
+    if (t->n < t->cap)
+        return;
+    t->cap = t->cap ? t->cap * 2 : DEFAULT_EVENT_CAPACITY;
+    t->act = realloc(t->act, sizeof(action_t) * t->cap);
+    t->cnt = realloc(t->cnt, sizeof(count_t) * t->cap);
+    t->parent = realloc(t->parent, sizeof(int) * t->cap);
+    t->child = realloc(t->child, sizeof(int) * t->cap);
+    t->next = realloc(t->next, sizeof(int) * t->cap);
+}
+
+// returns the child of node p whose prefix ends with action a, adding it
+// with a count of 0 if p has none
+static int trieChild(trie_t *t, int p, action_t a)
+{
+    for (int c = t->child[p]; c >= 0; c = t->next[c])
+    {
+        if (t->act[c] == a)
+            return c;
+    }
+    growTrie(t);
+    int c = t->n++;
+    t->act[c] = a;
+    t->cnt[c] = 0;
+    t->parent[c] = p;
+    t->child[c] = -1;
+    t->next[c] = t->child[p];
+    t->child[p] = c;
+    return c;
+}
+
+// empties the prefix tree down to its root
+static void initTrie(trie_t *t)
+{
+    t->n = 0;
+    growTrie(t);
+    t->n = 1;
+    t->act[0] = 0;
+    t->cnt[0] = 0;
+    t->parent[0] = -1;
+    t->child[0] = -1;
+    t->next[0] = -1;
+}
+
+// releases the arrays of the prefix tree
+static void freeTrie(trie_t *t)
+{
+    free(t->act);
+    free(t->cnt);
+    free(t->parent);
+    free(t->child);
+    free(t->next);
+    free(t->ends);
+    *t = (trie_t){0};
+}
+
+// builds the prefix tree of the distinct traces of the log, every node
+// counting the cases that pass through it
+static void buildTrie(trie_t *t, log_t *log)
+{
+    freeTrie(t);
+    initTrie(t);
+    t->nend = log->ndtr;
+    t->ends = malloc(sizeof(int) * (log->ndtr ? log->ndtr : 1));
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        trace_t *tr = &log->trcs[v];
+        int node = 0;
+        t->cnt[0] += tr->freq;
+        for (int cur = tr->head; cur <= tr->foot; cur++)
+        {
+            node = trieChild(t, node, log->evts[cur]);
+            t->cnt[node] += tr->freq;
+        }
+        t->ends[v] = node;
+    }
+}
+
+// counts the DF relation and the event frequencies of the engine from
+// scratch, once per edge of the prefix tree weighted by the cases passing
+// through it instead of once per event
+static void trieDF(trie_t *t, df_t *df, log_t *log)
+{
+    dfReset(df, log);
+    int *idx = df->dict->idx;
+    for (int i = 1; i < t->n; i++)
+    {
+        int c = idx[t->act[i]];
+        df->evtFreqs[c] += t->cnt[i];
+        int p = t->parent[i];
+        if (p > 0)
+            dfAdd(df, idx[t->act[p]], c, t->cnt[i]);
+    }
+    dfSettle(df, log);
+}
+
+// rewrites the prefix tree as rewriteLog rewrites the log: since the rewrite
+// of a trace only depends on what comes before each event, every node is
+// rewritten once, a node collapsed into its parent removing the cases that
+// pass through it, and nodes that become the same prefix are merged. The
+// codes are added to the dictionary, and the edges of the operands in df are
+// moved over to the codes as they are rewritten, left pending for dfLink;
+// fills in the events each rule removed and returns the events removed in
+// total
+static count_t rewriteTrie(trie_t *t, df_t *df, node_t *rules, int k)
+{
+    if (k <= 0)
+        return 0;
+    dict_t *d = df->dict;
+    action_t lo = rules[0].code;
+    action_t *codeOf = calloc(d->nact + k, sizeof(action_t));
+    for (int i = 0; i < k; i++)
+    {
+        codeOf[d->idx[rules[i].x]] = rules[i].code;
+        codeOf[d->idx[rules[i].y]] = rules[i].code;
+        rules[i].removed = 0;
+    }
+    for (int i = 0; i < k; i++)
+        dictAdd(d, rules[i].code);
+    growDF(df);
+    df->ntch = 0;
+
+    trie_t nt = {0};
+    initTrie(&nt);
+    nt.cnt[0] = t->cnt[0];
+    int *map = malloc(sizeof(int) * t->n);
+    map[0] = 0;
+    count_t total = 0;
+    for (int i = 1; i < t->n; i++)
+    {
+        int p = map[t->parent[i]];
+        action_t a = t->act[i];
+        action_t z = codeOf[d->idx[a]];
+        // an edge between two other actions keeps both of its ends
+        action_t b = t->act[t->parent[i]];
+        if (t->parent[i] > 0 && (z || codeOf[d->idx[b]]))
+            dfAdd(df, d->idx[b], d->idx[a], -t->cnt[i]);
+        if (z)
+        {
+            if (p > 0 && nt.act[p] == z)
+            {
+                rules[z - lo].removed += t->cnt[i];
+                total += t->cnt[i];
+                map[i] = p;
+                continue;
+            }
+            a = z;
+        }
+        if (p > 0 && (z || nt.act[p] >= lo))
+            dfAdd(df, d->idx[nt.act[p]], d->idx[a], t->cnt[i]);
+        map[i] = trieChild(&nt, p, a);
+        nt.cnt[map[i]] += t->cnt[i];
+    }
+    for (int v = 0; v < t->nend; v++)
+        t->ends[v] = map[t->ends[v]];
+    nt.ends = t->ends;
+    nt.nend = t->nend;
+    t->ends = NULL;
+    freeTrie(t);
+    *t = nt;
+    free(map);
+    free(codeOf);
+    return total;
+}
+
+/* Snapshots -----------------------------------------------------------------*/
+
+// writes bytes from p and pads them to a multiple of 8; returns 0, or -1 if
+// the write fails
+static int snapPut(FILE *fp, const void *p, size_t bytes)
+{
+    static const char pad[8] = {0};
+    if (bytes && fwrite(p, 1, bytes, fp) != bytes)
+        return -1;
+    size_t rest = (8 - bytes % 8) % 8;
+    return rest && fwrite(pad, 1, rest, fp) != rest ? -1 : 0;
+}
+
+// returns the section of the given bytes at *off in the snapshot and moves
+// *off past it, or NULL if the snapshot is too short, which leaves *off past
+// len so every later section is too
+static const void *snapTake(const char *buf, size_t len, size_t *off, size_t bytes)
+{
+    size_t end = *off + (bytes + 7) / 8 * 8;
+    if (*off > len || end > len || end < *off)
+    {
+        *off = len + 1;
+        return NULL;
+    }
+    const void *p = buf + *off;
+    *off = end;
+    return p;
+}
+
+// writes the log and its DF relation as a snapshot; returns 0, or -1 if the
+// file cannot be written
+static int saveSnapshot(log_t *log, df_t *df, FILE *fp)
+{
+    dfCommit(df);
+    int n = df->size;
+    int *rowPtr = malloc(sizeof(int) * (n + 1));
+    int *cols = df->cols;
+    count_t *vals = df->vals;
+    if (df->sparse)
+        memcpy(rowPtr, df->rowPtr, sizeof(int) * (n + 1));
+    else
+    {
+        int nnz = 0;
+        for (int r = 0; r < n; r++)
+            for (int c = 0; c < n; c++)
+                nnz += df->matrix[(size_t)r * df->stride + c] != 0;
+        cols = malloc(sizeof(int) * (nnz ? nnz : 1));
+        vals = malloc(sizeof(count_t) * (nnz ? nnz : 1));
+        nnz = 0;
+        for (int r = 0; r < n; r++)
+        {
+            rowPtr[r] = nnz;
+            for (int c = 0; c < n; c++)
+            {
+                count_t cnt = df->matrix[(size_t)r * df->stride + c];
+                if (cnt != 0)
+                {
+                    cols[nnz] = c;
+                    vals[nnz++] = cnt;
+                }
+            }
+        }
+        rowPtr[n] = nnz;
+    }
+
+    snapHead_t hd = {0};
+    memcpy(hd.magic, SNAP_MAGIC, 4);
+    hd.version = SNAP_VERSION;
+    hd.ndtr = log->ndtr;
+    hd.nevt = log->nevt;
+    hd.ncas = log->ncas;
+    hd.hasCases = log->cases != NULL;
+    hd.nact = n;
+    hd.nname = log->names.n;
+    hd.firstCode = log->dict.firstCode;
+    hd.nnz = rowPtr[n];
+    hd.tlen = log->names.tlen;
+    int res = snapPut(fp, &hd, sizeof(hd));
+    res |= snapPut(fp, log->dict.actns, sizeof(action_t) * n);
+    res |= snapPut(fp, log->trcs, sizeof(trace_t) * log->ndtr);
+    res |= snapPut(fp, log->hashes, sizeof(unsigned int) * log->ndtr);
+    res |= snapPut(fp, log->evts, sizeof(action_t) * log->nevt);
+    res |= snapPut(fp, log->cases, hd.hasCases ? sizeof(int) * log->ncas : 0);
+    res |= snapPut(fp, log->names.text, log->names.tlen);
+    res |= snapPut(fp, df->evtFreqs, sizeof(count_t) * n);
+    res |= snapPut(fp, rowPtr, sizeof(int) * (n + 1));
+    res |= snapPut(fp, cols, sizeof(int) * hd.nnz);
+    res |= snapPut(fp, vals, sizeof(count_t) * hd.nnz);
+    if (!df->sparse)
+    {
+        free(cols);
+        free(vals);
+    }
+    free(rowPtr);
+    return res;
+}
+
+// checks the sections of a snapshot against each other before any of them
+// is copied: the first code follows from the names, the dictionary holds
+// distinct activities, every event is in it, traces lie within the events,
+// cases point at traces, the CSR relation stays within the dictionary and no
+// count exceeds the events of the log, at most SNAP_COUNT_LIMIT; returns 0,
+// or -1 if the snapshot cannot be trusted
+static int snapCheck(const snapHead_t *hd, const action_t *actns, const trace_t *trcs,
+                     const action_t *evts, const int *cases, const char *text,
+                     const count_t *evtFreqs, const int *rowPtr, const int *cols,
+                     const count_t *vals)
+{
+    int n = hd->nact;
+    int nname = 0;
+    for (count_t i = 0; i < hd->tlen; i++)
+        nname += text[i] == '\0';
+    if (nname != hd->nname || (hd->tlen && text[hd->tlen - 1] != '\0') ||
+        hd->firstCode != (action_t)(nname > FIRST_CODE ? nname : FIRST_CODE) ||
+        (hd->hasCases != 0 && hd->hasCases != 1))
+        return -1;
+
+    char *seen = calloc(hd->firstCode, 1);
+    int ok = 1;
+    for (int i = 0; ok && i < n; i++)
+    {
+        ok = actns[i] < hd->firstCode && !seen[actns[i]];
+        if (ok)
+            seen[actns[i]] = 1;
+    }
+    for (int i = 0; ok && i < hd->nevt; i++)
+        ok = evts[i] < hd->firstCode && seen[evts[i]];
+    free(seen);
+    count_t total = 0;
+    for (int v = 0; ok && v < hd->ndtr; v++)
+    {
+        ok = trcs[v].head >= 0 && trcs[v].head - 1 <= trcs[v].foot &&
+             trcs[v].foot < hd->nevt && trcs[v].freq >= 0;
+        total += ok ? (count_t)trcs[v].freq * (trcs[v].foot - trcs[v].head + 1) : 0;
+        ok = ok && total <= SNAP_COUNT_LIMIT;
+    }
+    for (int i = 0; ok && i < n; i++)
+        ok = evtFreqs[i] >= 0 && evtFreqs[i] <= total;
+    for (int i = 0; ok && i < hd->nnz; i++)
+        ok = vals[i] >= 0 && vals[i] <= total;
+    for (int i = 0; ok && hd->hasCases && i < hd->ncas; i++)
+        ok = cases[i] >= 0 && cases[i] < hd->ndtr;
+    ok = ok && rowPtr[0] == 0 && rowPtr[n] == hd->nnz;
+    for (int r = 0; ok && r < n; r++)
+    {
+        ok = rowPtr[r] <= rowPtr[r + 1] && rowPtr[r + 1] <= hd->nnz;
+        for (int i = rowPtr[r]; ok && i < rowPtr[r + 1]; i++)
+            ok = cols[i] >= 0 && cols[i] < n && (i == rowPtr[r] || cols[i - 1] < cols[i]);
+    }
+    return ok ? 0 : -1;
+}
+
+// fills an empty log and its engine from the snapshot in the len bytes of
+// buf, copying the sections into place without counting anything again once
+// snapCheck has found them sound; returns 0, or -1 with errno set to EINVAL
+// if buf is not a snapshot this build can read, or to ENOMEM
+static int loadSnapshot(log_t *log, df_t *df, const char *buf, size_t len)
+{
+    size_t off = 0;
+    const snapHead_t *hd = snapTake(buf, len, &off, sizeof(snapHead_t));
+    if (hd == NULL || memcmp(hd->magic, SNAP_MAGIC, 4) != 0 ||
+        hd->version != SNAP_VERSION || hd->ndtr < 0 || hd->nevt < 0 ||
+        hd->ncas < 0 || hd->nact < 0 || hd->nname < 0 || hd->nnz < 0 ||
+        hd->tlen < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    int n = hd->nact;
+    const action_t *actns = snapTake(buf, len, &off, sizeof(action_t) * n);
+    const trace_t *trcs = snapTake(buf, len, &off, sizeof(trace_t) * hd->ndtr);
+    const unsigned int *hashes = snapTake(buf, len, &off, sizeof(unsigned int) * hd->ndtr);
+    const action_t *evts = snapTake(buf, len, &off, sizeof(action_t) * hd->nevt);
+    const int *cases = snapTake(buf, len, &off, hd->hasCases ? sizeof(int) * hd->ncas : 0);
+    const char *text = snapTake(buf, len, &off, hd->tlen);
+    const count_t *evtFreqs = snapTake(buf, len, &off, sizeof(count_t) * n);
+    const int *rowPtr = snapTake(buf, len, &off, sizeof(int) * (n + 1));
+    const int *cols = snapTake(buf, len, &off, sizeof(int) * hd->nnz);
+    const count_t *vals = snapTake(buf, len, &off, sizeof(count_t) * hd->nnz);
+    if (vals == NULL || off != len ||
+        snapCheck(hd, actns, trcs, evts, cases, text, evtFreqs, rowPtr, cols, vals) < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < n; i++)
+        dictAdd(&log->dict, actns[i]);
+    log->dict.firstCode = hd->firstCode;
+    for (const char *s = text; s < text + hd->tlen; s += strlen(s) + 1)
+        intern(&log->names, s, strlen(s));
+
+    log->trcs = arenaAlloc(&log->arena, sizeof(trace_t) * (hd->ndtr ? hd->ndtr : 1));
+    log->hashes = arenaAlloc(&log->arena, sizeof(unsigned int) * (hd->ndtr ? hd->ndtr : 1));
+    log->evts = arenaAlloc(&log->arena, sizeof(action_t) * (hd->nevt ? hd->nevt : 1));
+    if (hd->hasCases)
+        log->cases = arenaAlloc(&log->arena, sizeof(int) * (hd->ncas ? hd->ncas : 1));
+    if (!log->trcs || !log->hashes || !log->evts || (hd->hasCases && !log->cases))
+        return -1;
+    log->ndtr = log->cpct = hd->ndtr;
+    memcpy(log->trcs, trcs, sizeof(trace_t) * hd->ndtr);
+    memcpy(log->hashes, hashes, sizeof(unsigned int) * hd->ndtr);
+    log->nevt = log->ecap = hd->nevt;
+    memcpy(log->evts, evts, sizeof(action_t) * hd->nevt);
+    log->ncas = hd->ncas;
+    if (hd->hasCases)
+        memcpy(log->cases, cases, sizeof(int) * hd->ncas);
+    int nslt = DEFAULT_SLOT_CAPACITY;
+    while (2 * (log->ndtr + 1) > nslt)
+        nslt *= 2;
+    log->nslt = nslt / 2;
+    if (growSlots(log) < 0)
+        return -1;
+
+    dfReset(df, log);
+    if (n)
+        memcpy(df->evtFreqs, evtFreqs, sizeof(count_t) * n);
+    if (df->sparse)
+    {
+        memcpy(df->rowPtr, rowPtr, sizeof(int) * (n + 1));
+        df->cols = malloc(sizeof(int) * (hd->nnz ? hd->nnz : 1));
+        df->vals = malloc(sizeof(count_t) * (hd->nnz ? hd->nnz : 1));
+        memcpy(df->cols, cols, sizeof(int) * hd->nnz);
+        memcpy(df->vals, vals, sizeof(count_t) * hd->nnz);
+        df->nnz = hd->nnz;
+    }
+    else
+    {
+        for (int r = 0; r < n; r++)
+            for (int i = rowPtr[r]; i < rowPtr[r + 1]; i++)
+                df->matrix[(size_t)r * df->stride + cols[i]] = vals[i];
+    }
+    dfSettle(df, log);
+    return 0;
+}
+
+// adds the log src, a shard read apart, and its DF relation to the log dst
+// and its relation, as if the cases of src had been read after those of
+// dst: activities are matched by name, distinct traces new to dst go after
+// its own and the event frequencies and DF counts are summed. The cases are
+// only kept if both logs keep them. Returns 0, or -1 with errno set to
+// EINVAL if one log names its activities and the other uses letters, or to
+// EOVERFLOW if together they hold more events or cases than an int counts
+static int mergeLog(log_t *dst, df_t *ddf, log_t *src, df_t *sdf)
+{
+    if ((dst->names.n > 0) != (src->names.n > 0) && dst->dict.nact > 0 &&
+        src->dict.nact > 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (src->ncas > INT_MAX - dst->ncas || src->nevt > INT_MAX - dst->nevt)
+    {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    int nname = src->names.n;
+    action_t *map = malloc(sizeof(action_t) * (nname ? nname : 1));
+    for (int i = 0; i < nname; i++)
+    {
+        const char *name = minerNameOf(&src->names, i);
+        map[i] = intern(&dst->names, name, strlen(name));
+    }
+    if ((action_t)dst->names.n > dst->dict.firstCode)
+        dst->dict.firstCode = dst->names.n;
+
+    int *vmap = malloc(sizeof(int) * (src->ndtr ? src->ndtr : 1));
+    action_t *actns = NULL;
+    int cap = 0, ok = 1;
+    for (int v = 0; ok && v < src->ndtr; v++)
+    {
+        trace_t *tr = &src->trcs[v];
+        int len = tr->foot - tr->head + 1;
+        if (len > cap)
+        {
+            cap = len;
+            actns = realloc(actns, sizeof(action_t) * cap);
+        }
+        for (int i = 0; i < len; i++)
+        {
+            action_t a = src->evts[tr->head + i];
+            actns[i] = a < (action_t)nname ? map[a] : a;
+        }
+        vmap[v] = findVariant(dst, actns, len);
+        ok = vmap[v] >= 0;
+        if (ok)
+            dst->trcs[vmap[v]].freq += tr->freq;
+    }
+    free(actns);
+
+    if (ok && dst->cases && src->cases)
+    {
+        int *cases = arenaGrow(&dst->arena, dst->cases, sizeof(int) * dst->ncas,
+                               sizeof(int) * (dst->ncas + src->ncas));
+        ok = cases != NULL;
+        for (int i = 0; ok && i < src->ncas; i++)
+            cases[dst->ncas + i] = vmap[src->cases[i]];
+        dst->cases = ok ? cases : dst->cases;
+    }
+    else if (ok && dst->cases)
+    {
+        arenaFree(&dst->arena, dst->cases, sizeof(int) * dst->ncas);
+        dst->cases = NULL;
+    }
+    free(vmap);
+    if (!ok)
+    {
+        free(map);
+        errno = ENOMEM;
+        return -1;
+    }
+    dst->ncas += src->ncas;
+
+    // the dense index in dst of every dense index of src
+    int *to = malloc(sizeof(int) * (sdf->size ? sdf->size : 1));
+    for (int i = 0; i < sdf->size; i++)
+    {
+        action_t a = src->dict.actns[i];
+        to[i] = dictAdd(&dst->dict, a < (action_t)nname ? map[a] : a);
+    }
+    free(map);
+    growDF(ddf);
+    if (!ddf->sparse && ddf->size > DF_DENSE_LIMIT)
+        dfToSparse(ddf);
+    dfCommit(sdf);
+    for (int r = 0; r < sdf->size; r++)
+    {
+        ddf->evtFreqs[to[r]] += sdf->evtFreqs[r];
+        if (sdf->sparse)
+        {
+            for (int i = sdf->rowPtr[r]; i < sdf->rowPtr[r + 1]; i++)
+                dfAdd(ddf, to[r], to[sdf->cols[i]], sdf->vals[i]);
+            continue;
+        }
+        for (int c = 0; c < sdf->size; c++)
+        {
+            count_t cnt = sdf->matrix[(size_t)r * sdf->stride + c];
+            if (cnt != 0)
+                dfAdd(ddf, to[r], to[c], cnt);
+        }
+    }
+    free(to);
+    dfSettle(ddf, dst);
+    return 0;
+}
+
+/* Process tree model --------------------------------------------------------*/
+
+// the automata of the patterns, next[type][state][operand] is the state after
+// reading a block of the left or right operand, -1 if the pattern cannot
+// read it there; every pattern starts in state 0. rewriteLog relabels a lone
+// x or y to the code as well, so one operand on its own is a block too
+static const signed char patNext[3][4][2] = {
+    {{1, 1}, {-1, -1}, {-1, -1}, {-1, -1}}, // CHC: x or y
+    {{1, 2}, {-1, 3}, {3, -1}, {-1, -1}},   // CON: x and y in either order
+    {{1, 3}, {-1, 2}, {-1, -1}, {-1, -1}},  // SEQ: x then y, or y alone
+};
+// patDone[type][state] tells whether a block of the pattern may end there
+static const char patDone[3][4] = {{0, 1, 0, 0}, {0, 1, 1, 1}, {0, 1, 1, 1}};
+
+// writes a name on one line, escaping backslashes and line ends
+static void putName(FILE *fp, const char *s)
+{
+    for (; *s; s++)
+    {
+        if (*s == '\\')
+            fputs("\\\\", fp);
+        else if (*s == '\n')
+            fputs("\\n", fp);
+        else if (*s == '\r')
+            fputs("\\r", fp);
+        else
+            fputc(*s, fp);
+    }
+    fputc('\n', fp);
+}
+
+// undoes putName in place on a line without its line end; returns the length
+static size_t getName(char *s)
+{
+    size_t n = 0;
+    for (size_t i = 0; s[i]; i++)
+    {
+        if (s[i] == '\\' && s[i + 1])
+        {
+            i++;
+            s[n++] = s[i] == 'n' ? '\n' : s[i] == 'r' ? '\r' : s[i];
+        }
+        else
+            s[n++] = s[i];
+    }
+    s[n] = '\0';
+    return n;
+}
+
+// writes the activities and patterns of a log as a process tree file
+static int saveModel(log_t *log, node_t *nodes, int nnode, FILE *fp)
+{
+    static const char *typeStr[] = {"CHC", "CON", "SEQ"};
+    dict_t *d = &log->dict;
+    int nact = 0;
+    for (int i = 0; i < d->nact; i++)
+        nact += d->actns[i] < d->firstCode;
+    fprintf(fp, "ptree %d\nfirst %u\nactions %d\n", MODEL_VERSION, d->firstCode, nact);
+    for (int i = 0, k = 0; i < d->nact; i++)
+    {
+        if (d->actns[i] < d->firstCode)
+            fprintf(fp, ++k < nact ? "%u " : "%u", d->actns[i]);
+    }
+    fprintf(fp, "\nnames %d\n", log->names.n);
+    for (int i = 0; i < log->names.n; i++)
+        putName(fp, minerNameOf(&log->names, i));
+    fprintf(fp, "nodes %d\n", nnode);
+    for (int i = 0; i < nnode; i++)
+        fprintf(fp, "%u %s %u %u\n", nodes[i].code, typeStr[nodes[i].type],
+                nodes[i].x, nodes[i].y);
+    return ferror(fp) ? -1 : 0;
+}
+
+// builds the replay tables of a model whose patterns are read; returns 0, or
+// -1 if an action is an operand of two patterns or of a later one
+static int compileModel(model_t *md, action_t *actns, int nact)
+{
+    int size = md->size = md->firstCode + md->nnode;
+    md->known = calloc(size, 1);
+    md->slot = calloc(size, 1);
+    int *parent = malloc(sizeof(int) * size);
+    for (int a = 0; a < size; a++)
+        parent[a] = -1;
+    int ok = 1;
+    for (int i = 0; i < nact && ok; i++)
+    {
+        ok = actns[i] < md->firstCode;
+        if (ok)
+            md->known[actns[i]] = 1;
+    }
+    for (int i = 0; i < md->nnode && ok; i++)
+    {
+        node_t *nd = &md->nodes[i];
+        md->known[nd->code] = 1;
+        action_t ops[2] = {nd->x, nd->y};
+        for (int s = 0; s < 2 && ok; s++)
+        {
+            action_t a = ops[s];
+            ok = a < nd->code && md->known[a] && parent[a] == -1 && nd->x != nd->y;
+            if (ok)
+            {
+                parent[a] = i;
+                md->slot[a] = s;
+            }
+        }
+    }
+    if (!ok)
+    {
+        free(parent);
+        return -1;
+    }
+
+    md->coff = malloc(sizeof(int) * (size + 1));
+    int len = 0;
+    for (int a = 0; a < size; a++)
+    {
+        md->coff[a] = len;
+        for (int p = parent[a]; p != -1; p = parent[md->firstCode + p])
+            len++;
+    }
+    md->coff[size] = len;
+    md->chain = malloc(sizeof(int) * (len ? len : 1));
+    md->height = 0;
+    for (int a = 0; a < size; a++)
+    {
+        int depth = md->coff[a + 1] - md->coff[a];
+        int k = md->coff[a + 1];
+        for (int p = parent[a]; p != -1; p = parent[md->firstCode + p])
+            md->chain[--k] = p;
+        md->height = depth > md->height ? depth : md->height;
+    }
+    free(parent);
+    return 0;
+}
+
+// replays one trace of model actions, an action of md->size or above being
+// unknown, and returns the position of the first event it deviates at, len
+// if it stops short of a pattern, or -1 if it fits; a run of events under
+// one pattern has to be a run of its blocks, as rewriteLog collapses the
+// codes of back to back blocks into one, and events under no pattern may
+// come in any order. nodes and states hold md->height entries
+static int replayTrace(model_t *md, const action_t *map, const action_t *evts, int len,
+                       int *nodes, signed char *states)
+{
+    int h = 0;
+    for (int i = 0; i <= len; i++)
+    {
+        action_t a = i < len ? map[evts[i]] : 0;
+        if (i < len && ((int)a >= md->size || !md->known[a]))
+            return i;
+        const int *chain = md->chain + md->coff[a];
+        int d = i < len ? md->coff[a + 1] - md->coff[a] : 0;
+        int j = 0;
+        while (j < h && j < d && nodes[j] == chain[j])
+            j++;
+        // the deeper blocks end here
+        for (int k = h - 1; k >= j; k--)
+        {
+            if (!patDone[md->nodes[nodes[k]].type][(int)states[k]])
+                return i;
+        }
+        if (i == len)
+            break;
+        // the blocks of the ancestors not open yet start here, then the
+        // event itself is read by its parent
+        for (h = j; h <= d; h++)
+        {
+            if (h > 0)
+            {
+                action_t op = h < d ? md->firstCode + chain[h] : a;
+                int k = h - 1;
+                int type = md->nodes[nodes[k]].type;
+                signed char s = patNext[type][(int)states[k]][(int)md->slot[op]];
+                if (s < 0 && patDone[type][(int)states[k]])
+                    s = patNext[type][0][(int)md->slot[op]];
+                if (s < 0)
+                    return i;
+                states[k] = s;
+            }
+            if (h < d)
+            {
+                nodes[h] = chain[h];
+                states[h] = 0;
+            }
+        }
+        h = d;
+    }
+    return -1;
+}
+
+// replays one share of the distinct traces
+static void *replaySpan(void *arg)
+{
+    span_t *sp = arg;
+    model_t *md = sp->md;
+    log_t *log = &sp->rp->log;
+    int *nodes = malloc(sizeof(int) * (md->height + 1));
+    signed char *states = malloc(md->height + 1);
+    for (int i = sp->from; i < sp->to; i++)
+    {
+        trace_t *tr = &log->trcs[i];
+        sp->rp->dev[i] = replayTrace(md, sp->map, log->evts + tr->head,
+                                     tr->foot - tr->head + 1, nodes, states);
+    }
+    free(nodes);
+    free(states);
+    return NULL;
+}
+
+/* Windowed DF store ---------------------------------------------------------*/
+
+// puts case i in bucket i / perBucket; returns the number of buckets, 0 if
+// the log does not know its cases
+int minerBucketByCount(log_t *log, int perBucket, int *bucket)
+{
+    if (log->cases == NULL || perBucket < 1)
+        return 0;
+    for (int i = 0; i < log->ncas; i++)
+        bucket[i] = i / perBucket;
+    return (log->ncas + perBucket - 1) / perBucket;
+}
+
+// puts every case in the bucket of width seconds its start time falls in,
+// counted from the earliest start, and a case without a time in none (-1);
+// returns the number of buckets, 0 if the log has no times
+int minerBucketByTime(log_t *log, double width, int *bucket)
+{
+    if (log->times == NULL || log->cases == NULL || !(width > 0))
+        return 0;
+    double t0 = INFINITY;
+    for (int i = 0; i < log->ncas; i++)
+    {
+        if (log->times[i] < t0)
+            t0 = log->times[i];
+    }
+    int nb = 0;
+    for (int i = 0; i < log->ncas; i++)
+    {
+        bucket[i] = isnan(log->times[i]) ? -1 : (int)((log->times[i] - t0) / width);
+        if (bucket[i] + 1 > nb)
+            nb = bucket[i] + 1;
+    }
+    return nb;
+}
+
+// returns the position of cell (row, col) among the cells of the store
+static int cellIndex(wdf_t *w, int row, int col)
+{
+    int lo = w->rowPtr[row], hi = w->rowPtr[row + 1] - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (w->cols[mid] < col)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// builds the store over the nb buckets of the cases of a log as read, case
+// i going to bucket[i], or to none if that is -1; every distinct trace is
+// counted once per bucket it occurs in, weighted by its cases there
+void minerBuildWindows(wdf_t *w, log_t *log, const int *bucket, int nb)
+{
+    memset(w, 0, sizeof(wdf_t));
+    int n = w->n = log->dict.nact;
+    int *idx = log->dict.idx;
+    w->nb = nb;
+
+    // the cells are those of all distinct traces, sorted and merged
+    dfcell_t *cells = malloc(sizeof(dfcell_t) * (log->nevt ? log->nevt : 1));
+    int ncell = 0;
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        trace_t *tr = &log->trcs[v];
+        for (int p = tr->head; p < tr->foot; p++)
+            cells[ncell++] = (dfcell_t){idx[log->evts[p]], idx[log->evts[p + 1]], 0};
+    }
+    qsort(cells, ncell, sizeof(dfcell_t), cmpCell);
+    w->rowPtr = calloc(n + 1, sizeof(int));
+    w->cols = malloc(sizeof(int) * (ncell ? ncell : 1));
+    int k = 0;
+    for (int i = 0; i < ncell; i++)
+    {
+        if (k > 0 && cells[i].row == cells[i - 1].row && cells[i].col == cells[i - 1].col)
+            continue;
+        w->cols[k++] = cells[i].col;
+        w->rowPtr[cells[i].row + 1]++;
+    }
+    for (int r = 0; r < n; r++)
+        w->rowPtr[r + 1] += w->rowPtr[r];
+    w->ncell = k;
+    free(cells);
+
+    // the cell of every adjacent pair of events, looked up once
+    int *cellOf = malloc(sizeof(int) * (log->nevt ? log->nevt : 1));
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        trace_t *tr = &log->trcs[v];
+        for (int p = tr->head; p < tr->foot; p++)
+            cellOf[p] = cellIndex(w, idx[log->evts[p]], idx[log->evts[p + 1]]);
+    }
+
+    // the cases of every bucket, then the counts of every bucket
+    int *start = calloc(nb + 1, sizeof(int));
+    int *order = malloc(sizeof(int) * (log->ncas ? log->ncas : 1));
+    for (int i = 0; i < log->ncas; i++)
+    {
+        if (bucket[i] >= 0)
+            start[bucket[i] + 1]++;
+    }
+    for (int b = 0; b < nb; b++)
+        start[b + 1] += start[b];
+    int *fill = malloc(sizeof(int) * (nb ? nb : 1));
+    memcpy(fill, start, sizeof(int) * (nb ? nb : 1));
+    for (int i = 0; i < log->ncas; i++)
+    {
+        if (bucket[i] >= 0)
+            order[fill[bucket[i]]++] = log->cases[i];
+    }
+    free(fill);
+
+    w->stride = w->ncell + n;
+    w->pre = calloc((size_t)(nb + 1) * w->stride, sizeof(count_t));
+    w->cases = calloc(nb + 1, sizeof(int));
+    int *cnt = calloc(log->ndtr ? log->ndtr : 1, sizeof(int));
+    int *seen = malloc(sizeof(int) * (log->ndtr ? log->ndtr : 1));
+    for (int b = 0; b < nb; b++)
+    {
+        int nseen = 0;
+        for (int i = start[b]; i < start[b + 1]; i++)
+        {
+            if (cnt[order[i]]++ == 0)
+                seen[nseen++] = order[i];
+        }
+        count_t *row = w->pre + (size_t)(b + 1) * w->stride;
+        for (int s = 0; s < nseen; s++)
+        {
+            int v = seen[s];
+            trace_t *tr = &log->trcs[v];
+            for (int p = tr->head; p <= tr->foot; p++)
+            {
+                row[w->ncell + idx[log->evts[p]]] += cnt[v];
+                if (p < tr->foot)
+                    row[cellOf[p]] += cnt[v];
+            }
+            cnt[v] = 0;
+        }
+        count_t *prev = row - w->stride;
+        for (int j = 0; j < w->stride; j++)
+            row[j] += prev[j];
+        w->cases[b + 1] = w->cases[b] + start[b + 1] - start[b];
+    }
+    free(cnt);
+    free(seen);
+    free(order);
+    free(start);
+    free(cellOf);
+}
+
+// releases the store
+void minerFreeWindows(wdf_t *w)
+{
+    free(w->rowPtr);
+    free(w->cols);
+    free(w->pre);
+    free(w->cases);
+    memset(w, 0, sizeof(wdf_t));
+}
+
+// fills an empty engine bound to the log with the counts of buckets from up
+// to to of the store, the difference of two prefix rows
+static void windowDF(wdf_t *w, int from, int to, df_t *df, log_t *log)
+{
+    dfReset(df, log);
+    count_t *hi = w->pre + (size_t)to * w->stride;
+    count_t *lo = w->pre + (size_t)from * w->stride;
+    for (int j = 0; j < w->n; j++)
+        df->evtFreqs[j] = hi[w->ncell + j] - lo[w->ncell + j];
+    for (int r = 0; r < w->n; r++)
+    {
+        for (int k = w->rowPtr[r]; k < w->rowPtr[r + 1]; k++)
+        {
+            count_t cnt = hi[k] - lo[k];
+            if (cnt != 0)
+                dfAdd(df, r, w->cols[k], cnt);
+        }
+    }
+    dfSettle(df, log);
+}
+
+/* Pattern scoring ----------------------------------------------------------*/
+
+// splits the rows of the scores into one share per thread
+static rows_t *splitRows(score_t *sc, df_t *df, int *nParts)
+{
+    int n = sc->threads < 1 ? 1 : sc->threads;
+    if (n > sc->n)
+        n = sc->n ? sc->n : 1;
+    rows_t *parts = calloc(n, sizeof(rows_t));
+    for (int k = 0; k < n; k++)
+        parts[k] = (rows_t){sc, df, sc->n * k / n, sc->n * (k + 1) / n, -1, 0, -1, {0}};
+    *nParts = n;
+    return parts;
+}
+
+// returns the count, below 2^52, as a double: or-ed into the mantissa of 2^52
+// it is that double plus 2^52, which takes no conversion instruction
+static double countToDouble(count_t x)
+{
+    count_t bits = x | 0x4330000000000000LL;
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d - 0x1p52;
+}
+
+// fills the pd and w entries of a row from its supports, which must be below
+// PD_EXACT_LIMIT; the loop has no branches and divides in doubles, so gcc -O3
+// vectorizes it on targets with 64-bit compares (SSE4.2 and up). Both counts
+// of the division are then below 2^52 and the quotient is at least 1 / max
+// away from the next integer, so truncating it gives the integer division
+static void scoreRow(const count_t *restrict sup, const count_t *restrict supT,
+                     int *restrict pd, count_t *restrict w, int n)
+{
+    for (int c = 0; c < n; c++)
+    {
+        count_t a = sup[c], b = supT[c];
+        count_t max = a > b ? a : b;
+        count_t diff = max - (a < b ? a : b);
+        count_t den = max + (max == 0);
+        int p = (int)(countToDouble(100 * diff) / countToDouble(den));
+        int dev = p > 50 ? p - 50 : 50 - p;
+        pd[c] = p;
+        w[c] = dev * max;
+    }
+}
+
+// fills the pd and w entries of a row with supports of any size
+static void scoreRowWide(const count_t *sup, const count_t *supT, int *pd, count_t *w, int n)
+{
+    for (int c = 0; c < n; c++)
+    {
+        count_t diff = sup[c] > supT[c] ? sup[c] - supT[c] : supT[c] - sup[c];
+        count_t max = sup[c] > supT[c] ? sup[c] : supT[c];
+        pd[c] = max > 0 ? (int)(100 * diff / max) : 0;
+        w[c] = (pd[c] > 50 ? pd[c] - 50 : 50 - pd[c]) * max;
+    }
+}
+
+// fills the sup, pd and w tables of one share of rows: the supports of a row
+// are gathered first, from the dense matrix directly or by a search of the
+// CSR rows, then its pd and w are computed in one pass over the row
+static void *scoreRows(void *arg)
+{
+    rows_t *rp = arg;
+    score_t *sc = rp->sc;
+    df_t *df = rp->df;
+    int n = sc->n;
+    int *cols = malloc(sizeof(int) * (n ? n : 1));
+    for (int c = 0; c < n; c++)
+        cols[c] = df->dict->idx[sc->actns[c]];
+    for (int r = rp->from; r < rp->to; r++)
+    {
+        count_t *sup = sc->sup + (size_t)r * n;
+        count_t *supT = sc->supT + (size_t)r * n;
+        int ir = cols[r];
+        if (df->sparse)
+        {
+            for (int c = 0; c < n; c++)
+            {
+                sup[c] = dfGet(df, ir, cols[c]);
+                supT[c] = dfGet(df, cols[c], ir);
+            }
+        }
+        else
+        {
+            const count_t *row = df->matrix + (size_t)ir * df->stride;
+            for (int c = 0; c < n; c++)
+            {
+                sup[c] = row[cols[c]];
+                supT[c] = df->matrix[(size_t)cols[c] * df->stride + ir];
+            }
+        }
+        count_t top = 0;
+        for (int c = 0; c < n; c++)
+            top |= sup[c] | supT[c];
+        int *pd = sc->pd + (size_t)r * n;
+        count_t *w = sc->w + (size_t)r * n;
+        if (top < PD_EXACT_LIMIT)
+            scoreRow(sup, supT, pd, w, n);
+        else
+            scoreRowWide(sup, supT, pd, w, n);
+    }
+    free(cols);
+    return NULL;
+}
+
+// sets the thresholds the original heuristics used: sequences above a pd of
+// 70, concurrency below 30, choices up to 1 percent of the live actions, and
+// a boost of 100 for concurrency and for sequences of two activities
+void minerDefaultThresh(thresh_t *th)
+{
+    *th = (thresh_t){70, 30, 1, 0, 100, 100, 100};
+}
+
+// returns the largest support a pair of a choice may have while nLive
+// actions are live
+static count_t chcLimit(const thresh_t *th, int nLive)
+{
+    return th->chcSup + (count_t)nLive * th->chcPct / 100;
+}
+
+// sorts the pairs of one share of rows into the concurrency and sequence
+// buckets and counts every bucket, choices going by the live actions
+static void *classRows(void *arg)
+{
+    rows_t *rp = arg;
+    score_t *sc = rp->sc;
+    const thresh_t *th = sc->th;
+    int n = sc->n;
+    count_t lim = chcLimit(th, sc->nLive);
+    for (int r = rp->from; r < rp->to; r++)
+    {
+        for (int c = 0; c < n; c++)
+        {
+            int p = r * n + c;
+            count_t supxy = sc->sup[p];
+            count_t supyx = sc->supT[p];
+            count_t max = supxy > supyx ? supxy : supyx;
+            sc->cls[p] = -1;
+            sc->cw[p] = 0;
+            if (r == c)
+                continue;
+            if (supxy > 0 && supyx > 0 && sc->pd[p] < th->conPd)
+            {
+                sc->cls[p] = PAT_CON;
+                sc->cw[p] = th->conW * sc->w[p];
+            }
+            else if (supxy > supyx && sc->pd[p] > th->seqPd)
+            {
+                sc->cls[p] = PAT_SEQ;
+                sc->cw[p] = sc->w[p];
+                if (sc->isChr[r] && sc->isChr[c])
+                    sc->cw[p] *= th->seqW;
+            }
+            if (max <= lim)
+                rp->nCls[PAT_CHC]++;
+            else if (sc->cls[p] >= 0)
+                rp->nCls[(int)sc->cls[p]]++;
+        }
+    }
+    return NULL;
+}
+
+// classifies every scored pair by the given thresholds, so the searches of a
+// round only compare weights; the scores themselves are not computed again
+static void classifyPairs(score_t *sc, const thresh_t *th)
+{
+    sc->th = th;
+    memset(sc->nCls, 0, sizeof(sc->nCls));
+    int nParts;
+    rows_t *parts = splitRows(sc, NULL, &nParts);
+    runWorkers(classRows, parts, sizeof(rows_t), nParts);
+    for (int k = 0; k < nParts; k++)
+        for (int t = 0; t < 3; t++)
+            sc->nCls[t] += parts[k].nCls[t];
+    free(parts);
+}
+
+// computes sup, pd and w once for every ordered pair of the actions still in
+// the log, splitting the rows across df->threads threads, and classifies the
+// pairs by the given thresholds
+static void scorePairs(score_t *sc, df_t *df, const thresh_t *th)
+{
+    int n = df->nlive;
+    if (n > sc->cpct)
+    {
+        sc->cpct = n;
+        size_t cells = (size_t)n * n;
+        sc->isChr = realloc(sc->isChr, n);
+        sc->dead = realloc(sc->dead, n);
+        sc->sup = realloc(sc->sup, sizeof(count_t) * cells);
+        sc->supT = realloc(sc->supT, sizeof(count_t) * cells);
+        sc->pd = realloc(sc->pd, sizeof(int) * cells);
+        sc->w = realloc(sc->w, sizeof(count_t) * cells);
+        sc->cls = realloc(sc->cls, cells);
+        sc->cw = realloc(sc->cw, sizeof(count_t) * cells);
+    }
+    sc->n = n;
+    sc->nLive = n;
+    sc->actns = df->live;
+    sc->threads = df->threads;
+    if (n > 0)
+        memset(sc->dead, 0, n);
+    for (int r = 0; r < n; r++)
+        sc->isChr[r] = sc->actns[r] < df->dict->firstCode;
+
+    int nParts;
+    rows_t *parts = splitRows(sc, df, &nParts);
+    runWorkers(scoreRows, parts, sizeof(rows_t), nParts);
+    free(parts);
+    classifyPairs(sc, th);
+}
+
+// releases the tables of the scores
+static void freeScores(score_t *sc)
+{
+    free(sc->isChr);
+    free(sc->dead);
+    free(sc->sup);
+    free(sc->supT);
+    free(sc->pd);
+    free(sc->w);
+    free(sc->cls);
+    free(sc->cw);
+    *sc = (score_t){0};
+}
+
+// finds the first pair of one share of rows, in row-major order, that has
+// the highest weight among the sequence candidates
+static void *seqRows(void *arg)
+{
+    rows_t *rp = arg;
+    score_t *sc = rp->sc;
+    int n = sc->n;
+    for (int r = rp->from; r < rp->to; r++)
+    {
+        if (sc->dead[r])
+            continue;
+        for (int c = 0; c < n; c++)
+        {
+            int p = r * n + c;
+            if (r == c || p == sc->dflt || sc->pd[p] <= sc->th->seqPd || sc->dead[c])
+                continue;
+            if (rp->best < 0 || sc->w[p] > rp->bestW)
+            {
+                rp->best = p;
+                rp->bestW = sc->w[p];
+            }
+        }
+    }
+    return NULL;
+}
+
+// finds the sequence pair for stage 1: the first pair with pd > seqPd and a
+// weight above that of the pair of the first two actions, or that pair
+// itself if there is no such pair; ties go to the pair that comes first in
+// row-major order, and dead actions are skipped; returns the weight, or -1
+// if fewer than two actions are left
+static count_t getSeq(action_t *outX, action_t *outY, score_t *sc)
+{
+    int n = sc->n;
+    *outX = 0;
+    *outY = 0;
+    int r0 = 0;
+    while (r0 < n && sc->dead[r0])
+        r0++;
+    int r1 = r0 + 1;
+    while (r1 < n && sc->dead[r1])
+        r1++;
+    if (r1 >= n)
+        return -1;
+    sc->dflt = r0 * n + r1;
+
+    int nParts;
+    rows_t *parts = splitRows(sc, NULL, &nParts);
+    runWorkers(seqRows, parts, sizeof(rows_t), nParts);
+    int best = sc->dflt;
+    count_t bestW = sc->w[best];
+    for (int k = 0; k < nParts; k++)
+    {
+        if (parts[k].best >= 0 && parts[k].bestW > bestW)
+        {
+            best = parts[k].best;
+            bestW = parts[k].bestW;
+        }
+    }
+    free(parts);
+    *outX = sc->actns[best / n];
+    *outY = sc->actns[best % n];
+    return bestW;
+}
+
+/* Stage 2 ----------------------------------------------------------------------------------s*/
+// finds the first pair of one share of rows, in row-major order, that has the
+// highest stage 2 weight; a choice takes precedence over the bucket of a
+// pair, and its limit goes by the actions that will be live
+static void *rows2(void *arg)
+{
+    rows_t *rp = arg;
+    score_t *sc = rp->sc;
+    int n = sc->n;
+    count_t lim = chcLimit(sc->th, sc->nLive);
+    count_t chcW = (count_t)sc->nLive * sc->th->chcW;
+    for (int r = rp->from; r < rp->to; r++)
+    {
+        if (sc->dead[r])
+            continue;
+        for (int c = 0; c < n; c++)
+        {
+            if (r == c || sc->dead[c])
+                continue;
+            int p = r * n + c;
+            count_t max = sc->sup[p] > sc->supT[p] ? sc->sup[p] : sc->supT[p];
+            count_t weight;
+            int type;
+            if (max <= lim)
+            {
+                weight = chcW;
+                type = PAT_CHC;
+            }
+            else if (sc->cls[p] >= 0)
+            {
+                weight = sc->cw[p];
+                type = sc->cls[p];
+            }
+            else
+                continue;
+
+            if (weight > rp->bestW)
+            {
+                rp->bestW = weight;
+                rp->best = p;
+                rp->type = type;
+            }
+        }
+    }
+    return NULL;
+}
+
+// finds the best stage 2 pattern, outType is left at -1 if there is none;
+// ties go to the pair that comes first in row-major order, and dead actions
+// are skipped; returns the weight
+static count_t get2(action_t *outX, action_t *outY, int *outType, score_t *sc)
+{
+    int n = sc->n;
+    *outType = -1;
+    if (sc->nLive < 2)
+        return 0;
+
+    int nParts;
+    rows_t *parts = splitRows(sc, NULL, &nParts);
+    runWorkers(rows2, parts, sizeof(rows_t), nParts);
+    int best = -1;
+    count_t maxWeight = 0;
+    for (int k = 0; k < nParts; k++)
+    {
+        if (parts[k].best >= 0 && parts[k].bestW > maxWeight)
+        {
+            maxWeight = parts[k].bestW;
+            best = parts[k].best;
+            *outType = parts[k].type;
+        }
+    }
+    free(parts);
+    if (best < 0)
+        return 0;
+    *outX = sc->actns[best / n];
+    *outY = sc->actns[best % n];
+    return maxWeight;
+}
+
+// returns the position of the live action a in the scores
+static int scorePos(score_t *sc, action_t a)
+{
+    action_t *p = bsearch(&a, sc->actns, sc->n, sizeof(action_t), cmpActn);
+    return p - sc->actns;
+}
+
+// returns the weight of the pair x, y of a new code in the given stage, from
+// sup(x, y) and sup(y, x), or -1 if the search of that stage would not take
+// it: in stage 1 it must be a sequence candidate heavier than the default
+// pair, weighing wDflt, in stage 2 a pattern; a code is never a letter, so
+// sequences get no boost
+static count_t codeWeight(score_t *sc, int stage, count_t s, count_t t, count_t wDflt)
+{
+    const thresh_t *th = sc->th;
+    count_t max = s > t ? s : t;
+    count_t diff = max - (s < t ? s : t);
+    int pd = max > 0 ? (int)(100 * diff / max) : 0;
+    count_t w = (pd > 50 ? pd - 50 : 50 - pd) * max;
+    if (stage == 1)
+        return pd > th->seqPd && w > wDflt ? w : -1;
+    if (max <= chcLimit(th, sc->nLive))
+        return (count_t)sc->nLive * th->chcW;
+    if (s > 0 && t > 0 && pd < th->conPd)
+        return th->conW * w;
+    if (s > t && pd > th->seqPd)
+        return w;
+    return -1;
+}
+
+// returns the position of u in the adjacencies of codeAdj: the score
+// position of a live action, or n + i for the code of pattern i of a batch
+// whose first code is lo
+static int adjPos(score_t *sc, action_t lo, action_t u)
+{
+    return u >= lo ? sc->n + (int)(u - lo) : scorePos(sc, u);
+}
+
+// codeAdj over the prefix tree: every node is rewritten once after its
+// parent, as rewriteTrie would, last[i] being the last event left on the
+// path to node i, and an edge counts the cases passing through its child
+static void codeAdjTrie(miner_t *m, node_t *nds, int j, const int *code, count_t *out, count_t *in)
+{
+    trie_t *t = &m->trie;
+    score_t *sc = &m->sc;
+    int *idx = m->log.dict.idx;
+    action_t lo = nds[0].code, z = nds[j].code;
+    action_t *last = malloc(sizeof(action_t) * t->n);
+    last[0] = 0;
+    for (int i = 1; i < t->n; i++)
+    {
+        int p = t->parent[i];
+        int d = idx[t->act[i]];
+        action_t u = code[d] >= 0 ? nds[code[d]].code : t->act[i];
+        action_t prev = last[p];
+        last[i] = u;
+        if (p == 0)
+            continue;
+        if (u == prev && u >= lo)
+        {
+            last[i] = prev;
+            continue;
+        }
+        if (prev == z)
+            out[adjPos(sc, lo, u)] += t->cnt[i];
+        if (u == z)
+            in[adjPos(sc, lo, prev)] += t->cnt[i];
+    }
+    free(last);
+}
+
+// counts how often the code of pattern j of a batch directly follows and
+// precedes every action once patterns 0 to j are folded, adding them to
+// out and in at the score position of the action, or at n + i for the code
+// of pattern i. The log, or the prefix tree that stands for it, is rewritten
+// on the fly as rewriteLog would, code[d] being the pattern the action with
+// dense index d is folded by, -1 if none
+static void codeAdj(miner_t *m, node_t *nds, int j, const int *code, count_t *out, count_t *in)
+{
+    if (m->prefix)
+    {
+        codeAdjTrie(m, nds, j, code, out, in);
+        return;
+    }
+    log_t *log = &m->log;
+    score_t *sc = &m->sc;
+    int *idx = log->dict.idx;
+    action_t lo = nds[0].code, z = nds[j].code;
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        trace_t *tr = &log->trcs[v];
+        action_t prev = 0;
+        int pp = -1; // the position of prev, -1 before the first event
+        for (int cur = tr->head; cur <= tr->foot; cur++)
+        {
+            int d = idx[log->evts[cur]];
+            action_t u = code[d] >= 0 ? nds[code[d]].code : log->evts[cur];
+            if (pp >= 0 && u == prev && u >= lo)
+                continue;
+            int pu = adjPos(sc, lo, u);
+            if (pp >= 0 && prev == z)
+                out[pu] += tr->freq;
+            if (pp >= 0 && u == z)
+                in[pp] += tr->freq;
+            prev = u;
+            pp = pu;
+        }
+    }
+}
+
+// checks whether the search of the round after folding the first k patterns
+// of a batch would take a pair of one of their codes before the candidate
+// at row r of the scores, of weight bestW: the pair weighs more, or as much
+// and comes first in row-major order, which only a pair of an action and a
+// code at a row above r does, since codes sort last. A tie only counts if
+// the candidate was not taken by default. The pairs of code j are out and in
+// at adj + 2 * j * width
+static int codeFirst(score_t *sc, int stage, const count_t *adj, int k, int width, int r,
+                     count_t bestW, int byDefault)
+{
+    count_t wDflt = stage == 1 ? sc->w[sc->dflt] : 0;
+    for (int j = 0; j < k; j++)
+    {
+        const count_t *out = adj + (size_t)2 * j * width;
+        const count_t *in = out + width;
+        for (int u = 0; u < sc->n + j; u++)
+        {
+            if (u < sc->n && sc->dead[u])
+                continue;
+            // the action before the code, then the code before the action
+            count_t wIn = codeWeight(sc, stage, in[u], out[u], wDflt);
+            count_t wOut = codeWeight(sc, stage, out[u], in[u], wDflt);
+            if (wIn > bestW || wOut > bestW)
+                return 1;
+            if (wIn == bestW && !byDefault && u < r)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/* Metrics -------------------------------------------------------------------*/
+
+// returns the time in seconds on a monotonic clock
+double minerNow(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// returns the bytes held by the arena of the log
+static size_t arenaBytes(arena_t *a)
+{
+    size_t n = 0;
+    for (chunk_t *ch = a->chunks; ch; ch = ch->next)
+        n += CHUNK_HEAD + ch->size;
+    return n;
+}
+
+// reports one load phase of stage 0
+static void emitLoad(miner_t *m, const char *phase, double secs)
+{
+    fprintf(m->metrics, "{\"stage\":0,\"phase\":\"%s\",\"ms\":%.3f,"
+                        "\"cases\":%d,\"traces\":%d,\"events\":%d,"
+                        "\"actions\":%d,\"bytes\":%zu}\n",
+            phase, 1e3 * secs, m->log.ncas, m->log.ndtr, m->log.nevt,
+            m->log.dict.nact, minerBytes(m));
+}
+
+// returns the events the miner folds, the nodes of its prefix tree below
+// the root if it folds that
+static int heldEvents(miner_t *m)
+{
+    return m->prefix ? m->trie.n - 1 : m->log.nevt;
+}
+
+// reports a round that folded the k patterns in nds
+static void emitRound(miner_t *m, node_t *nds, int k, double rewrite)
+{
+    count_t removed = 0;
+    for (int i = 0; i < k; i++)
+        removed += nds[i].removed;
+    fprintf(m->metrics, "{\"stage\":%d,\"round\":%d,\"patterns\":%d,"
+                        "\"search_ms\":%.3f,\"rewrite_ms\":%.3f,"
+                        "\"removed\":%lld,\"touched\":%d,\"traces\":%d,"
+                        "\"events\":%d,\"live\":%d,\"bytes\":%zu}\n",
+            m->stage, m->nRounds, k, 1e3 * m->tSearch, 1e3 * rewrite, removed,
+            m->df.ntch, m->log.ndtr, heldEvents(m), m->df.nlive, minerBytes(m));
+}
+
+// reports the totals of the current stage once it is done
+static void emitStage(miner_t *m)
+{
+    if (m->reported)
+        return;
+    m->reported = 1;
+    fprintf(m->metrics, "{\"stage\":%d,\"rounds\":%d,\"patterns\":%d,"
+                        "\"search_ms\":%.3f,\"rewrite_ms\":%.3f,"
+                        "\"events\":%d,\"live\":%d,\"bytes\":%zu}\n",
+            m->stage, m->nRounds, m->round, 1e3 * m->searchSecs,
+            1e3 * m->rewriteSecs, heldEvents(m), m->df.nlive, minerBytes(m));
+}
+
+// records the time of a search that started at t0, and reports the stage
+// once a search comes back empty
+static void endSearch(miner_t *m, double t0, int found)
+{
+    m->tSearch = minerNow() - t0;
+    m->searchSecs += m->tSearch;
+    if (!found)
+        emitStage(m);
+}
+
+/* Miner API -----------------------------------------------------------------*/
+
+// returns an empty miner whose counting and scoring passes use the given
+// number of threads
+miner_t *minerNew(int threads)
+{
+    miner_t *m = calloc(1, sizeof(miner_t));
+    initLog(&m->log);
+    m->df.threads = threads;
+    m->code = 256;
+    minerDefaultThresh(&m->th);
+    return m;
+}
+
+// releases the miner and everything it holds
+void minerFree(miner_t *m)
+{
+    if (m == NULL)
+        return;
+    freeScores(&m->sc);
+    freeDF(&m->df);
+    freeLog(&m->log);
+    freeTrie(&m->trie);
+    free(m->tree);
+    free(m);
+}
+
+// fills an empty miner with the traces in the len bytes of buf, one per
+// line; returns 0, or -1 with errno set to EOVERFLOW if they are too many
+int minerReadBuffer(miner_t *m, const char *buf, size_t len)
+{
+    double t = m->metrics ? minerNow() : 0;
+    store_t st = {0};
+    if (minerLoadBuffer(&st, buf, len) < 0)
+        return -1;
+    if (m->metrics)
+    {
+        fprintf(m->metrics, "{\"stage\":0,\"phase\":\"load\",\"ms\":%.3f,"
+                            "\"cases\":%d,\"events\":%d,\"bytes\":%zu}\n",
+                1e3 * (minerNow() - t), st.ntrc, st.nevt, len);
+        t = minerNow();
+    }
+    int res = minerCalcTrcsFreq(&m->log, &st);
+    minerFreeStore(&st);
+    if (res < 0)
+        return -1;
+    if (m->metrics)
+    {
+        emitLoad(m, "dedup", minerNow() - t);
+        t = minerNow();
+    }
+    minerInitDFMatrix(&m->df, &m->log);
+    if (m->metrics)
+        emitLoad(m, "df", minerNow() - t);
+    return 0;
+}
+
+// fills an empty miner with the traces in the file, read through a mapping;
+// returns 0, or -1 if the file cannot be read or, with errno set to
+// EOVERFLOW, holds more events or traces than an int counts
+int minerReadFile(miner_t *m, const char *filename)
+{
+    double t = m->metrics ? minerNow() : 0;
+    store_t st = {0};
+    if (initTrcsFromFile(&st, filename) < 0)
+        return -1;
+    if (m->metrics)
+    {
+        fprintf(m->metrics, "{\"stage\":0,\"phase\":\"load\",\"ms\":%.3f,"
+                            "\"cases\":%d,\"events\":%d}\n",
+                1e3 * (minerNow() - t), st.ntrc, st.nevt);
+        t = minerNow();
+    }
+    int res = minerCalcTrcsFreq(&m->log, &st);
+    minerFreeStore(&st);
+    if (res < 0)
+        return -1;
+    if (m->metrics)
+    {
+        emitLoad(m, "dedup", minerNow() - t);
+        t = minerNow();
+    }
+    minerInitDFMatrix(&m->df, &m->log);
+    if (m->metrics)
+        emitLoad(m, "df", minerNow() - t);
+    return 0;
+}
+
+// fills an empty miner with the case,activity rows of a CSV log in the len
+// bytes of buf; activities are named, and codes start after their ids.
+// Returns 0, or -1 with errno set to EOVERFLOW if the rows are too many
+int minerReadCsvBuffer(miner_t *m, const char *buf, size_t len)
+{
+    double t = m->metrics ? minerNow() : 0;
+    store_t st = {0};
+    double *times;
+    if (loadCsvBuffer(&st, &m->log.names, buf, len, &times) < 0)
+        return -1;
+    if (times)
+    {
+        m->log.times = arenaAlloc(&m->log.arena, sizeof(double) * (st.ntrc ? st.ntrc : 1));
+        if (m->log.times)
+            memcpy(m->log.times, times, sizeof(double) * st.ntrc);
+        free(times);
+        if (m->log.times == NULL)
+        {
+            minerFreeStore(&st);
+            return -1;
+        }
+    }
+    names_t *names = &m->log.names;
+    m->log.dict.firstCode = names->n > FIRST_CODE ? names->n : FIRST_CODE;
+    m->code = m->log.dict.firstCode;
+    if (m->metrics)
+    {
+        fprintf(m->metrics, "{\"stage\":0,\"phase\":\"load\",\"ms\":%.3f,"
+                            "\"cases\":%d,\"events\":%d,\"activities\":%d,"
+                            "\"bytes\":%zu}\n",
+                1e3 * (minerNow() - t), st.ntrc, st.nevt, names->n, len);
+        t = minerNow();
+    }
+    int res = minerCalcTrcsFreq(&m->log, &st);
+    minerFreeStore(&st);
+    if (res < 0)
+        return -1;
+    if (m->metrics)
+    {
+        emitLoad(m, "dedup", minerNow() - t);
+        t = minerNow();
+    }
+    minerInitDFMatrix(&m->df, &m->log);
+    if (m->metrics)
+        emitLoad(m, "df", minerNow() - t);
+    return 0;
+}
+
+// fills an empty miner with a CSV log read through a mapping; returns 0, or
+// -1 if the file cannot be read or, with errno set to EOVERFLOW, holds more
+// rows than an int counts
+int minerReadCsvFile(miner_t *m, const char *filename)
+{
+    size_t len;
+    const char *buf = mapFile(filename, &len);
+    if (buf == NULL)
+        return -1;
+    int res = minerReadCsvBuffer(m, buf, len);
+    unmapFile(buf, len);
+    return res;
+}
+
+// fills an empty miner with the traces in the file, read in chunks; the
+// cases are not kept apart from their distinct traces; returns 0, or -1 if
+// the file cannot be read
+int minerStreamFile(miner_t *m, const char *filename)
+{
+    double t = m->metrics ? minerNow() : 0;
+    int res = streamTrcsFromFile(&m->log, &m->df, filename);
+    if (m->metrics && res == 0)
+        emitLoad(m, "stream", minerNow() - t);
+    return res;
+}
+
+// makes the folds of the miner rewrite a prefix tree of its distinct traces
+// instead of the log, which stays as it was read; the DF relation is then
+// counted once per prefix rather than once per event, so logs whose traces
+// share long prefixes are folded with far less work. Must be called before
+// the first fold
+void minerUseTrie(miner_t *m)
+{
+    double t = m->metrics ? minerNow() : 0;
+    buildTrie(&m->trie, &m->log);
+    m->prefix = 1;
+    trieDF(&m->trie, &m->df, &m->log);
+    if (m->metrics)
+        emitLoad(m, "trie", minerNow() - t);
+}
+
+// writes the log of the miner as read, its distinct traces and initial DF
+// relation, to a snapshot file that minerLoadSnapshot reads back; returns 0,
+// or -1 if a pattern was folded already or the file cannot be written
+int minerSaveSnapshot(miner_t *m, const char *filename)
+{
+    if (m->ntree > 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+        return -1;
+    int res = saveSnapshot(&m->log, &m->df, fp);
+    if (fclose(fp) != 0)
+        res = -1;
+    return res;
+}
+
+// fills an empty miner from a snapshot file, read through a mapping; it is
+// then ready for stage 1 as if the original log had been read; returns 0,
+// or -1 if the file cannot be read or is not a snapshot
+int minerLoadSnapshot(miner_t *m, const char *filename)
+{
+    double t = m->metrics ? minerNow() : 0;
+    size_t len;
+    const char *buf = mapFile(filename, &len);
+    if (buf == NULL)
+        return -1;
+    int res = loadSnapshot(&m->log, &m->df, buf, len);
+    unmapFile(buf, len);
+    if (res < 0)
+        return -1;
+    m->code = m->log.dict.firstCode;
+    if (m->metrics)
+        emitLoad(m, "snapshot", minerNow() - t);
+    return 0;
+}
+
+// writes the patterns found so far and the activities of the log as a
+// process tree file that minerLoadModel reads back; returns 0, or -1 if the
+// file cannot be written
+int minerSaveModel(miner_t *m, const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL)
+        return -1;
+    int res = saveModel(&m->log, m->tree, m->ntree, fp);
+    if (fclose(fp) != 0)
+        res = -1;
+    return res;
+}
+
+// reads a process tree file written by minerSaveModel into an empty model
+// and compiles it for replay; returns 0, or -1 if the file cannot be read or
+// is not a process tree, errno being EINVAL then
+int minerLoadModel(model_t *md, const char *filename)
+{
+    memset(md, 0, sizeof(model_t));
+    md->names.arena = &md->arena;
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL)
+        return -1;
+    char *line = NULL;
+    size_t cap = 0;
+    int version = 0, nact = -1, nname = -1, ok = 1;
+    action_t *actns = NULL;
+    if (fscanf(fp, "ptree %d first %u actions %d", &version, &md->firstCode, &nact) != 3 ||
+        version != MODEL_VERSION || nact < 0)
+        ok = 0;
+    else
+    {
+        actns = malloc(sizeof(action_t) * (nact ? nact : 1));
+        for (int i = 0; i < nact && ok; i++)
+            ok = fscanf(fp, "%u", &actns[i]) == 1;
+    }
+    ok = ok && fscanf(fp, " names %d", &nname) == 1 && nname >= 0 && getline(&line, &cap, fp) > 0;
+    for (int i = 0; i < nname && ok; i++)
+    {
+        ssize_t n = getline(&line, &cap, fp);
+        ok = n > 0;
+        if (ok)
+        {
+            line[n - 1] = line[n - 1] == '\n' ? '\0' : line[n - 1];
+            ok = intern(&md->names, line, getName(line)) == i;
+        }
+    }
+    ok = ok && fscanf(fp, "nodes %d", &md->nnode) == 1 && md->nnode >= 0;
+    if (ok)
+        md->nodes = malloc(sizeof(node_t) * (md->nnode ? md->nnode : 1));
+    for (int i = 0; i < md->nnode && ok; i++)
+    {
+        node_t *nd = &md->nodes[i];
+        char type[4];
+        *nd = (node_t){0};
+        ok = fscanf(fp, "%u %3s %u %u", &nd->code, type, &nd->x, &nd->y) == 4 &&
+             nd->code == md->firstCode + i;
+        nd->type = strcmp(type, "CHC") == 0 ? PAT_CHC : strcmp(type, "CON") == 0 ? PAT_CON
+                                                      : strcmp(type, "SEQ") == 0 ? PAT_SEQ : -1;
+        ok = ok && nd->type >= 0;
+    }
+    ok = ok && md->firstCode >= (action_t)nname && compileModel(md, actns, nact) == 0;
+    free(line);
+    free(actns);
+    fclose(fp);
+    if (!ok)
+    {
+        minerFreeModel(md);
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+// releases everything held by the model
+void minerFreeModel(model_t *md)
+{
+    free(md->nodes);
+    free(md->known);
+    free(md->slot);
+    free(md->coff);
+    free(md->chain);
+    freeArena(&md->arena);
+    memset(md, 0, sizeof(model_t));
+}
+
+// reads a log, or a CSV log if csv is set, and replays its distinct traces
+// on the model across the given number of threads; activities are matched
+// by name, or by letter where either side has no names. Returns 0, or -1 if
+// the file cannot be read or, with errno set to EOVERFLOW, is too big
+int minerReplayFile(model_t *md, const char *filename, int csv, int threads,
+                    replay_t *rp)
+{
+    memset(rp, 0, sizeof(replay_t));
+    initLog(&rp->log);
+    log_t *log = &rp->log;
+    store_t st = {0};
+    size_t len;
+    const char *buf = mapFile(filename, &len);
+    if (buf == NULL)
+        return -1;
+    int res = csv ? loadCsvBuffer(&st, &log->names, buf, len, NULL)
+                  : minerLoadBuffer(&st, buf, len);
+    unmapFile(buf, len);
+    if (res == 0)
+        res = minerCalcTrcsFreq(log, &st);
+    minerFreeStore(&st);
+    if (res < 0)
+    {
+        freeLog(log);
+        return -1;
+    }
+
+    // resolves every action of the log to the model once, so the replay
+    // itself only reads tables
+    action_t *map = malloc(sizeof(action_t) * (log->dict.icap ? log->dict.icap : 1));
+    for (int i = 0; i < log->dict.nact; i++)
+    {
+        action_t a = log->dict.actns[i];
+        char letter[2] = {(char)a, '\0'};
+        const char *s = minerNameOf(&log->names, a);
+        s = s ? s : letter;
+        int id = md->names.n ? findName(&md->names, s, strlen(s))
+                 : strlen(s) == 1 ? (unsigned char)s[0] : -1;
+        map[a] = id >= 0 && id < md->size && id < (int)md->firstCode && md->known[id]
+                     ? (action_t)id : (action_t)md->size;
+    }
+
+    rp->dev = malloc(sizeof(int) * (log->ndtr ? log->ndtr : 1));
+    int n = threads < 1 ? 1 : threads;
+    if (n > log->ndtr)
+        n = log->ndtr ? log->ndtr : 1;
+    span_t *spans = malloc(sizeof(span_t) * n);
+    for (int k = 0; k < n; k++)
+        spans[k] = (span_t){md, rp, map, log->ndtr * k / n, log->ndtr * (k + 1) / n};
+    runWorkers(replaySpan, spans, sizeof(span_t), n);
+    free(spans);
+    free(map);
+    for (int i = 0; i < log->ndtr; i++)
+    {
+        if (rp->dev[i] < 0)
+        {
+            rp->nfit++;
+            rp->nfitCas += log->trcs[i].freq;
+        }
+    }
+    return 0;
+}
+
+// releases everything held by the replay
+void minerFreeReplay(replay_t *rp)
+{
+    free(rp->dev);
+    freeLog(&rp->log);
+    rp->dev = NULL;
+}
+
+// renumbers the named activities of a log in sorted name order, as
+// loadCsvBuffer numbers them, so ties break the same way; dense indices, and
+// so the DF counts, stay as they are
+static void sortNames(log_t *log)
+{
+    names_t *names = &log->names;
+    int n = names->n;
+    nameId_t *order = sortedNames(names);
+    action_t *map = malloc(sizeof(action_t) * (n ? n : 1));
+    names_t sorted = {0};
+    sorted.arena = &log->arena;
+    for (int i = 0; i < n; i++)
+        map[order[i].id] = intern(&sorted, order[i].name, strlen(order[i].name));
+    arenaFree(&log->arena, names->text, names->tcap);
+    arenaFree(&log->arena, names->offs, sizeof(size_t) * names->cap);
+    arenaFree(&log->arena, names->hashes, sizeof(unsigned int) * names->cap);
+    arenaFree(&log->arena, names->slots, sizeof(int) * names->nslt);
+    *names = sorted;
+
+    dict_t *d = &log->dict;
+    for (int i = 0; i < d->nact; i++)
+        d->idx[d->actns[i]] = -1;
+    for (int i = 0; i < d->nact; i++)
+    {
+        if (d->actns[i] < (action_t)n)
+            d->actns[i] = map[d->actns[i]];
+        d->idx[d->actns[i]] = i;
+    }
+    for (int i = 0; i < log->nevt; i++)
+    {
+        if (log->evts[i] < (action_t)n)
+            log->evts[i] = map[log->evts[i]];
+    }
+    for (int i = 0; i < log->ndtr; i++)
+    {
+        trace_t *tr = &log->trcs[i];
+        log->hashes[i] = hashTrace(log->evts + tr->head, tr->foot - tr->head + 1);
+    }
+    arenaFree(&log->arena, log->slots, sizeof(int) * log->nslt);
+    log->slots = NULL;
+    log->nslt /= 2;
+    growSlots(log);
+    free(order);
+    free(map);
+}
+
+// returns a new miner with the settings of m and a copy of its log as read,
+// made through an in-memory snapshot, so discovery can fold the copy while
+// m keeps taking cases; named activities are renumbered in sorted order, as
+// if the cases had been read from a CSV log. Returns NULL if the copy fails
+miner_t *minerFork(miner_t *m)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *fp = open_memstream(&buf, &len);
+    if (fp == NULL)
+        return NULL;
+    int res = saveSnapshot(&m->log, &m->df, fp);
+    if (fclose(fp) != 0)
+        res = -1;
+    miner_t *f = minerNew(m->df.threads);
+    f->batch = m->batch;
+    f->th = m->th;
+    if (res == 0)
+        res = loadSnapshot(&f->log, &f->df, buf, len);
+    free(buf);
+    if (res < 0)
+    {
+        minerFree(f);
+        return NULL;
+    }
+    if (f->log.names.n)
+    {
+        sortNames(&f->log);
+        dfSettle(&f->df, &f->log);
+    }
+    f->code = f->log.dict.firstCode;
+    return f;
+}
+
+// fills an empty miner with the n snapshots in files, each written by a
+// miner that read one shard of a log, merged in the given order: the log,
+// its dictionary, distinct traces, cases and DF relation end up as if the
+// shards had been read as one log, provided no case is split across two of
+// them. Returns 0, or -1 if a file cannot be read or is no snapshot, with
+// errno set to EINVAL if the shards do not go together or EOVERFLOW if
+// together they hold more events or cases than an int counts
+int minerMergeSnapshots(miner_t *m, char **files, int n)
+{
+    if (n <= 0 || minerLoadSnapshot(m, files[0]) < 0)
+        return -1;
+    double t = m->metrics ? minerNow() : 0;
+    for (int i = 1; i < n; i++)
+    {
+        size_t len;
+        const char *buf = mapFile(files[i], &len);
+        if (buf == NULL)
+            return -1;
+        log_t log;
+        df_t df = {0};
+        initLog(&log);
+        int res = loadSnapshot(&log, &df, buf, len);
+        unmapFile(buf, len);
+        if (res == 0)
+            res = mergeLog(&m->log, &m->df, &log, &df);
+        freeDF(&df);
+        freeLog(&log);
+        if (res < 0)
+            return -1;
+    }
+    if (n > 1 && m->log.names.n)
+    {
+        sortNames(&m->log);
+        dfSettle(&m->df, &m->log);
+    }
+    m->code = m->log.dict.firstCode;
+    if (m->metrics)
+        emitLoad(m, "merge", minerNow() - t);
+    return 0;
+}
+
+// fills an empty miner with the traces produced by next, which is called
+// with ctx until it returns 0; the cases are not kept apart from their
+// distinct traces; returns 0, or -1 with errno set to EOVERFLOW if they are
+// more than an int counts
+int minerReadIter(miner_t *m, traceIter_t next, void *ctx)
+{
+    double t = m->metrics ? minerNow() : 0;
+    dfReset(&m->df, &m->log);
+    action_t *actns;
+    int len, res = 0;
+    while (res == 0 && next(ctx, &actns, &len))
+    {
+        if (len > 0)
+            res = addCase(&m->log, &m->df, actns, len);
+    }
+    dfSettle(&m->df, &m->log);
+    if (m->metrics && res == 0)
+        emitLoad(m, "stream", minerNow() - t);
+    return res;
+}
+
+// fills the statistics of the log as it was read; the arrays of st are
+// released by minerFreeStats
+void minerStage0(miner_t *m, stats_t *st)
+{
+    log_t *log = &m->log;
+    st->nEvts = countEvts(log, m->df.threads);
+    st->distEvts = minerFindDistinctEvents(log, &st->nDistEvts);
+    st->evtFreqs = minerCalcEvtFreq(log, st->distEvts, st->nDistEvts, m->df.threads);
+    st->nDistTrcs = countDistinctTraces(log);
+    st->nTrcs = log->ncas;
+    trace_t *maxTr = getMaxFreqTrace(log);
+    st->maxFreq = maxTr ? maxTr->freq : 0;
+    st->maxLen = maxTr ? maxTr->foot - maxTr->head + 1 : 0;
+    st->maxTrc = malloc(sizeof(action_t) * (st->maxLen ? st->maxLen : 1));
+    if (maxTr)
+        memcpy(st->maxTrc, log->evts + maxTr->head, sizeof(action_t) * st->maxLen);
+}
+
+// releases the arrays of the statistics
+void minerFreeStats(stats_t *st)
+{
+    free(st->distEvts);
+    free(st->evtFreqs);
+    free(st->maxTrc);
+    *st = (stats_t){0};
+}
+
+// starts counting the patterns of a stage when the miner moves on to it
+static void enterStage(miner_t *m, int stage)
+{
+    if (m->stage != stage)
+    {
+        if (m->ntree == 0)
+            m->nInit = m->df.nlive;
+        m->stage = stage;
+        m->round = 0;
+        m->limit = stage == 1 ? m->nInit / 2 : m->log.ncas / 2;
+        m->searchSecs = 0;
+        m->rewriteSecs = 0;
+        m->nRounds = 0;
+        m->reported = 0;
+    }
+}
+
+// the search of minerFindPattern
+static int pickPattern(miner_t *m, int stage, node_t *nd)
+{
+    if (m->round >= m->limit)
+        return 0;
+
+    action_t x, y;
+    int type = PAT_SEQ;
+    if (stage == 1)
+    {
+        scorePairs(&m->sc, &m->df, &m->th);
+        action_t first = m->log.dict.firstCode;
+        if (getSeq(&x, &y, &m->sc) < 0 || x >= first || y >= first)
+            return 0;
+    }
+    else
+    {
+        if (m->df.nlive < 2)
+            return 0;
+        scorePairs(&m->sc, &m->df, &m->th);
+        get2(&x, &y, &type, &m->sc);
+        if (type < 0)
+            return 0;
+    }
+    m->round++;
+    *nd = (node_t){m->code, type, x, y, 0};
+    return 1;
+}
+
+// finds the next pattern of the given stage without folding it: stage 1
+// looks for sequences of two activities, at most half as many as there were
+// distinct events, stage 2 for any pattern, at most half as many as there
+// are cases; returns 1 and fills nd, or 0 if the stage is done
+int minerFindPattern(miner_t *m, int stage, node_t *nd)
+{
+    enterStage(m, stage);
+    double t = m->metrics ? minerNow() : 0;
+    int found = pickPattern(m, stage, nd);
+    if (m->metrics)
+        endSearch(m, t, found);
+    return found;
+}
+
+// classifies the scored pairs by the thresholds and stores in out their
+// buckets and the pattern of the given stage they would pick
+static void sweepPick(miner_t *m, int stage, const thresh_t *th, sweep_t *out)
+{
+    score_t *sc = &m->sc;
+    action_t first = m->log.dict.firstCode;
+    action_t x = 0, y = 0;
+    int type = PAT_SEQ;
+    classifyPairs(sc, th);
+    count_t weight;
+    if (stage == 1)
+    {
+        weight = getSeq(&x, &y, sc);
+        if (weight < 0 || x >= first || y >= first)
+            type = -1;
+    }
+    else
+        weight = get2(&x, &y, &type, sc);
+    out->th = *th;
+    out->best = (node_t){m->code, type, x, y, 0};
+    out->weight = type < 0 ? 0 : weight;
+    memcpy(out->nCls, sc->nCls, sizeof(sc->nCls));
+}
+
+// scores the pairs of the current round once and classifies them by each of
+// the k sets of thresholds in ths, storing in out[i] the buckets of set i and
+// the pattern of the given stage it would pick; nothing is folded and the
+// round is not counted, and the pairs are left classified by the thresholds
+// of the miner. Returns the number of sets tried
+int minerSweep(miner_t *m, int stage, const thresh_t *ths, int k, sweep_t *out)
+{
+    scorePairs(&m->sc, &m->df, &m->th);
+    for (int i = 0; i < k; i++)
+        sweepPick(m, stage, &ths[i], &out[i]);
+    classifyPairs(&m->sc, &m->th);
+    return k;
+}
+
+// scores the pairs of the window of buckets from up to to of a store built
+// from the log of the miner, without reading any trace, and stores in out[0]
+// and out[1] the first pattern stage 1 and stage 2 would pick there with the
+// thresholds of the miner; the scores, which named the actions of the window,
+// are left empty. Returns the number of cases in the window
+int minerWindow(miner_t *m, wdf_t *w, int from, int to, sweep_t *out)
+{
+    df_t df = {0};
+    df.threads = m->df.threads;
+    windowDF(w, from, to, &df, &m->log);
+    scorePairs(&m->sc, &df, &m->th);
+    sweepPick(m, 1, &m->th, &out[0]);
+    sweepPick(m, 2, &m->th, &out[1]);
+    freeDF(&df);
+    m->sc.actns = NULL;
+    m->sc.n = m->sc.nLive = 0;
+    return w->cases[to] - w->cases[from];
+}
+
+// folds the pattern found by minerFindPattern into its code, updating the log,
+// the DF relation and the tree, and fills in the events it removed
+void minerFoldPattern(miner_t *m, node_t *nd)
+{
+    double t = m->metrics ? minerNow() : 0;
+    if (m->prefix)
+        rewriteTrie(&m->trie, &m->df, nd, 1);
+    else
+        rewriteLog(&m->log, &m->df, nd, 1);
+    dfLink(&m->df, nd->x, nd->y, nd->code, nd->removed);
+
+    if (m->ntree == m->tcap)
+    {
+        m->tcap = m->tcap ? m->tcap * 2 : DEFAULT_DISTINCT_CAPACITY;
+        m->tree = realloc(m->tree, sizeof(node_t) * m->tcap);
+    }
+    m->tree[m->ntree++] = *nd;
+    m->code++;
+    m->nRounds++;
+    if (m->metrics)
+    {
+        double secs = minerNow() - t;
+        m->rewriteSecs += secs;
+        emitRound(m, nd, 1, secs);
+    }
+}
+
+// the search of minerFindBatch
+static int pickBatch(miner_t *m, int stage, int exact, node_t *nds, int max)
+{
+    if (m->round >= m->limit || (stage == 2 && m->df.nlive < 2))
+        return 0;
+    score_t *sc = &m->sc;
+    scorePairs(sc, &m->df, &m->th);
+
+    // in exact mode, the adjacencies of every code of the batch so far
+    int width = sc->n + max;
+    int *code = NULL;
+    count_t *adj = NULL;
+    if (exact)
+    {
+        code = malloc(sizeof(int) * (m->log.dict.nact ? m->log.dict.nact : 1));
+        for (int d = 0; d < m->log.dict.nact; d++)
+            code[d] = -1;
+        adj = calloc((size_t)2 * max * width, sizeof(count_t));
+    }
+    int k = 0;
+    while (k < max && m->round + k < m->limit)
+    {
+        action_t x, y;
+        int type = PAT_SEQ;
+        count_t weight;
+        sc->nLive = sc->n - k;
+        if (stage == 1)
+        {
+            weight = getSeq(&x, &y, sc);
+            action_t first = m->log.dict.firstCode;
+            if (weight < 0 || x >= first || y >= first)
+                break;
+        }
+        else
+        {
+            weight = get2(&x, &y, &type, sc);
+            if (type < 0)
+                break;
+        }
+        int rx = scorePos(sc, x), ry = scorePos(sc, y);
+        if (k > 0 && exact)
+        {
+            count_t *out = adj + (size_t)2 * (k - 1) * width;
+            codeAdj(m, nds, k - 1, code, out, out + width);
+            int byDefault = stage == 1 && rx * sc->n + ry == sc->dflt;
+            if (codeFirst(sc, stage, adj, k, width, rx, weight, byDefault))
+                break;
+        }
+
+        sc->dead[rx] = 1;
+        sc->dead[ry] = 1;
+        nds[k] = (node_t){m->code + k, type, x, y, 0};
+        if (exact)
+        {
+            code[m->log.dict.idx[x]] = k;
+            code[m->log.dict.idx[y]] = k;
+        }
+        k++;
+    }
+    free(code);
+    free(adj);
+    m->round += k;
+    return k;
+}
+
+// finds up to max patterns of the given stage in one round, scoring the
+// pairs once: after the best pattern, the best pattern among the actions
+// not yet used is taken again and again, so no two patterns share an action.
+// Folding a pair leaves the supports between other actions as they are, but
+// the new code brings pairs of its own. With exact set, the log is rewritten
+// on the fly after every pattern taken to count the pairs of its code, and a
+// further pattern is only taken if no such pair would be searched before it,
+// so the batch is what the one by one loop would find. Returns the number of
+// patterns stored in nds
+int minerFindBatch(miner_t *m, int stage, int exact, node_t *nds, int max)
+{
+    enterStage(m, stage);
+    double t = m->metrics ? minerNow() : 0;
+    int found = pickBatch(m, stage, exact, nds, max);
+    if (m->metrics)
+        endSearch(m, t, found);
+    return found;
+}
+
+// folds the k patterns found by minerFindBatch into their codes with one pass
+// over the log per step, updating the log, the DF relation and the tree, and
+// fills in the events each of them removed
+void minerFoldBatch(miner_t *m, node_t *nds, int k)
+{
+    if (k <= 0)
+        return;
+    double t = m->metrics ? minerNow() : 0;
+    log_t *log = &m->log;
+    df_t *df = &m->df;
+    if (m->prefix)
+        rewriteTrie(&m->trie, df, nds, k);
+    else
+        rewriteLog(log, df, nds, k);
+    dfLinkSet(df, nds, k);
+
+    if (m->ntree + k > m->tcap)
+    {
+        while (m->ntree + k > m->tcap)
+            m->tcap = m->tcap ? m->tcap * 2 : DEFAULT_DISTINCT_CAPACITY;
+        m->tree = realloc(m->tree, sizeof(node_t) * m->tcap);
+    }
+    memcpy(m->tree + m->ntree, nds, sizeof(node_t) * k);
+    m->ntree += k;
+    m->code += k;
+    m->nRounds++;
+    if (m->metrics)
+    {
+        double secs = minerNow() - t;
+        m->rewriteSecs += secs;
+        emitRound(m, nds, k, secs);
+    }
+}
+
+// finds and folds patterns of the given stage until it is done; returns the
+// number of patterns folded
+int minerRunStage(miner_t *m, int stage)
+{
+    int n = 0;
+    if (m->batch != BATCH_NONE)
+    {
+        int max = m->df.nlive / 2 + 1;
+        node_t *nds = malloc(sizeof(node_t) * max);
+        int k;
+        while ((k = minerFindBatch(m, stage, m->batch == BATCH_EXACT, nds, max)) > 0)
+        {
+            minerFoldBatch(m, nds, k);
+            n += k;
+        }
+        free(nds);
+        return n;
+    }
+    node_t nd;
+    while (minerFindPattern(m, stage, &nd))
+    {
+        minerFoldPattern(m, &nd);
+        n++;
+    }
+    return n;
+}
+
+// takes a snapshot of the DF relation and the frequencies of the live
+// actions; the arrays of mat are released by minerFreeDFMat
+void minerGetDF(miner_t *m, dfmat_t *mat)
+{
+    df_t *df = &m->df;
+    int n = df->nlive;
+    mat->n = n;
+    mat->actns = malloc(sizeof(action_t) * (n ? n : 1));
+    mat->freqs = malloc(sizeof(count_t) * (n ? n : 1));
+    mat->cells = malloc(sizeof(count_t) * (n ? (size_t)n * n : 1));
+    memcpy(mat->actns, df->live, sizeof(action_t) * n);
+    for (int r = 0; r < n; r++)
+    {
+        int ir = df->dict->idx[df->live[r]];
+        mat->freqs[r] = df->evtFreqs[ir];
+        for (int c = 0; c < n; c++)
+            mat->cells[(size_t)r * n + c] = dfGet(df, ir, df->dict->idx[df->live[c]]);
+    }
+}
+
+// takes a snapshot of the live actions and their frequencies only, leaving
+// the cells of mat NULL; its arrays are released by minerFreeDFMat
+void minerGetFreqs(miner_t *m, dfmat_t *mat)
+{
+    df_t *df = &m->df;
+    int n = df->nlive;
+    mat->n = n;
+    mat->actns = malloc(sizeof(action_t) * (n ? n : 1));
+    mat->freqs = malloc(sizeof(count_t) * (n ? n : 1));
+    mat->cells = NULL;
+    memcpy(mat->actns, df->live, sizeof(action_t) * n);
+    for (int r = 0; r < n; r++)
+        mat->freqs[r] = df->evtFreqs[df->dict->idx[df->live[r]]];
+}
+
+// releases the arrays of the snapshot
+void minerFreeDFMat(dfmat_t *mat)
+{
+    free(mat->actns);
+    free(mat->freqs);
+    free(mat->cells);
+    *mat = (dfmat_t){0};
+}
+
+// returns the patterns folded so far and stores their number in n
+node_t *minerTree(miner_t *m, int *n)
+{
+    *n = m->ntree;
+    return m->tree;
+}
+
+// returns the bytes the miner holds for its log, prefix tree, DF relation
+// and scores
+size_t minerBytes(miner_t *m)
+{
+    df_t *df = &m->df;
+    score_t *sc = &m->sc;
+    size_t n = arenaBytes(&m->log.arena);
+    n += (sizeof(action_t) + sizeof(count_t) + 3 * sizeof(int)) * (size_t)m->trie.cap +
+         sizeof(int) * m->trie.nend;
+    if (df->sparse)
+        n += sizeof(int) * (df->cpct + 1) +
+             (sizeof(int) + sizeof(count_t)) * df->nnz;
+    else
+        n += sizeof(count_t) * (size_t)df->stride * df->stride;
+    n += sizeof(dfcell_t) * df->pcap + sizeof(count_t) * df->cpct +
+         sizeof(action_t) * df->nlive + sizeof(int) * m->log.ndtr;
+    // sup, supT, w and cw, pd and cls per pair, isChr and dead per action
+    n += (4 * sizeof(count_t) + sizeof(int) + 1) * (size_t)sc->cpct * sc->cpct +
+         2 * (size_t)sc->cpct;
+    return n + sizeof(node_t) * m->tcap;
+}
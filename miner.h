@@ -0,0 +1,471 @@
+#ifndef MINER_H
+#define MINER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define DEFAULT_TOTAL_CAPACITY 15
+#define DEFAULT_DISTINCT_CAPACITY 5
+#define DEFAULT_EVENT_CAPACITY 64
+#define DEFAULT_SLOT_CAPACITY 32
+#define DEFAULT_ACTION_CAPACITY 512
+#define DEFAULT_THREADS 1
+#define FIRST_CODE 256 // the first code of a log whose activities are letters
+#define PAT_CHC 0 // a choice between two actions
+#define PAT_CON 1 // two actions running concurrently
+#define PAT_SEQ 2 // one action followed by the other
+#define BATCH_NONE 0  // fold one pattern per round
+#define BATCH_FAST 1  // fold every disjoint pattern of a round at once
+#define BATCH_EXACT 2 // only batch patterns the one-by-one loop would pick
+#define ARENA_CHUNK (1 << 16) // the bytes of the first chunk of an arena
+#define ARENA_CLASSES 48       // the size classes of an arena, 16 << k bytes
+#define CACHE_LINE 64 // the alignment of the rows of a dense DF matrix
+#define STREAM_CHUNK (1 << 20) // the bytes read at a time when streaming a log
+#define PENDING_LIMIT (1 << 20) // the CSR changes kept before merging them
+#define PD_EXACT_LIMIT (1LL << 45) // supports below it get their pd from a
+                                   //     double division without rounding
+#define SNAP_MAGIC "PMS\x1a" // the first bytes of a snapshot file
+#define SNAP_VERSION 1 // the layout of the snapshots written by this build
+#define SNAP_COUNT_LIMIT (1LL << 48) // the most events a snapshot may count, so
+                                     //     weighing its counts cannot overflow
+#define MODEL_VERSION 1 // the layout of the process tree files
+#define LIVE_SLACK 1024 // the closed case ids a live log keeps before
+                        //     dropping them from its id table
+#ifndef DF_DENSE_LIMIT
+#define DF_DENSE_LIMIT 1024 // logs with more actions keep their DF in CSR form
+#endif
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef unsigned int action_t; // an action is identified by an integer
+typedef long long count_t;     // a number of events, wide enough for big logs
+
+typedef struct
+{                  // a trace is a run of consecutive events in an event store
+    int head;      // the position of the first event of this trace
+    int foot;      // the position of the last event of this trace
+    int freq;      // the number of times this trace was observed
+} trace_t;
+
+typedef struct
+{                   // an event store keeps the events of all traces in one
+                    //     contiguous array, trace after trace
+    action_t *evts; // the actions of all events, in trace order
+    int nevt;       // the number of events in this store
+    int ecap;       // the number of events evts can hold
+    trace_t *trcs;  // the traces of this store, in the order they were read
+    int ntrc;       // the number of traces in this store
+    int tcap;       // the number of traces trcs can hold
+} store_t;
+
+typedef struct chunk
+{                        // a chunk of memory an arena hands out blocks from
+    struct chunk *next;  // the chunk taken before this one
+    size_t size;         // the bytes this chunk can hand out
+    size_t used;         // the bytes handed out so far
+} chunk_t;
+
+typedef struct
+{                    // an arena bumps blocks out of a few big chunks and keeps
+                     //     released blocks in one pool per size class
+    chunk_t *chunks; // the chunks of this arena, newest first
+    size_t next;     // the size of the next chunk to take
+    void *pools[ARENA_CLASSES]; // pools[k] lists released blocks of 16 << k
+                     //     bytes, linked through their first word
+} arena_t;
+
+typedef struct
+{                    // an activity dictionary maps actions to dense indices
+    int *idx;        // idx[a] is the dense index of action a, -1 if unknown
+    int icap;        // the number of actions idx can map
+    action_t *actns; // actns[i] is the action with dense index i
+    int nact;        // the number of actions in this dictionary
+    int acap;        // the number of actions actns can hold
+    arena_t *arena;  // the arena idx and actns are taken from
+    action_t firstCode; // the actions below it are activities, the ones
+                     //     from it on are codes of folded patterns
+} dict_t;
+
+typedef struct
+{                   // a name table interns activity names as dense ids
+    char *text;     // the names, each ended by a NUL, back to back
+    size_t tlen;    // the bytes used in text
+    size_t tcap;    // the bytes text can hold
+    size_t *offs;   // offs[i] is where the name with id i starts in text
+    unsigned int *hashes; // hashes[i] is the hash of the name with id i
+    int n;          // the number of names
+    int cap;        // the number of names offs and hashes can hold
+    int *slots;     // an open addressing table of ids, -1 marks an empty slot
+    int nslt;       // the number of slots, always a power of two
+    arena_t *arena; // the arena the arrays are taken from
+} names_t;
+
+typedef struct
+{                   // a name and its id, sorted by name without a shared
+                    //     table, so threads can sort names at once
+    const char *name; // the name
+    int id;         // its id in the name table
+} nameId_t;
+
+typedef struct
+{                  // an event log is an array of distinct traces
+                   //     in the order they were first observed
+    trace_t *trcs; // an array of traces
+    int ndtr;      // the number of distinct traces in this log
+    int cpct;      // the capacity of this event log as the number
+                   //     of  distinct traces it can hold
+    action_t *evts; // the events of the distinct traces, trace after trace
+    int nevt;      // the number of events in evts
+    int ecap;      // the number of events evts can hold
+    unsigned int *hashes; // hashes[i] is the hash of trcs[i]
+    int *slots;    // an open addressing table of indices into trcs,
+                   //     -1 marks an empty slot
+    int nslt;      // the number of slots, always a power of two
+    int *cases;    // cases[i] is the index of the distinct trace of case i,
+                   //     NULL if the log was streamed
+    int ncas;      // the number of cases (traces) observed in this log
+    double *times; // times[i] is the time case i started in seconds, NAN if
+                   //     it has none, NULL if the log has no times
+    dict_t dict;   // the actions occurring in this log, including codes
+    names_t names; // the names of the activities, empty if they are letters
+    arena_t arena; // the arena owning every array of this log
+} log_t;
+
+typedef struct
+{                  // a prefix tree of the distinct traces of a log: node 0 is
+                   //     the empty prefix, every other node one event longer
+                   //     than its parent, and parents come before children
+    action_t *act; // act[i] is the action of the last event of prefix i
+    count_t *cnt;  // cnt[i] is the number of cases that start with prefix i
+    int *parent;   // parent[i] is the node of prefix i without its last
+                   //     event, -1 for the root
+    int *child;    // child[i] is the first node one event longer than i,
+    int *next;     //     next[i] the next one with the same parent, -1 if none
+    int n;         // the number of nodes, the root included
+    int cap;       // the number of nodes the arrays can hold
+    int *ends;     // ends[v] is the node distinct trace v of the log ends at
+    int nend;      // the number of distinct traces in ends
+} trie_t;
+
+typedef count_t *DF_t; // a directly follows relation over dense action
+                       //     indices, one contiguous row-major block
+
+typedef struct
+{                  // a cell of a directly follows relation
+    int row;       // the dense index of the preceding action
+    int col;       // the dense index of the following action
+    count_t cnt;   // how often row is directly followed by col
+} dfcell_t;
+
+typedef struct
+{                  // the share of a log counted by one worker thread
+    log_t *log;    // the log being counted
+    int from;      // the first distinct trace of this share
+    int to;        // one past the last distinct trace of this share
+    int size;      // the number of dense indices to count frequencies over,
+                   //     0 to count events only
+    int wantDF;    // whether to count directly follows pairs as well
+    int sparse;    // whether to collect those pairs as cells
+    count_t *matrix;   // the thread-local size x size DF matrix
+    dfcell_t *cells;   // the thread-local DF cells, sorted and merged
+    int ncell;     // the number of cells
+    int ccap;      // the number of cells cells can hold
+    count_t *evtFreqs; // the thread-local frequencies by dense index
+    count_t nEvts; // the number of events in this share
+} part_t;
+
+typedef struct
+{                   // a directly follows engine keeps the DF relation and the
+                    //     event frequencies of a log up to date while pairs
+                    //     of actions are folded into codes
+    DF_t matrix;    // in dense form, matrix[i * stride + j] counts how often
+                    //     the action with dense index i is directly
+                    //     followed by the one with index j
+    int stride;     // the length of a row of matrix, a whole cache line
+    int sparse;     // whether the relation is kept in CSR form instead
+    int *rowPtr;    // in CSR form, row i is stored at rowPtr[i] up to
+                    //     rowPtr[i + 1] in cols and vals
+    int *cols;      // in CSR form, the columns of the stored cells,
+                    //     ascending within each row
+    count_t *vals;  // in CSR form, the counts of the stored cells
+    int nnz;        // in CSR form, the number of stored cells
+    dfcell_t *pend; // in CSR form, changes not merged into the rows yet
+    int npnd;       // the number of pending changes
+    int pcap;       // the number of pending changes pend can hold
+    count_t *evtFreqs; // evtFreqs[i] is the frequency of the action with
+                    //     dense index i
+    int size;       // the number of dense indices in use
+    int cpct;       // the number of dense indices the engine can hold
+    dict_t *dict;   // the dictionary of the log this relation describes
+    action_t *live; // the actions that still occur in the log, ascending
+    int nlive;      // the number of actions in live
+    int *touched;   // the distinct traces changed by the current fold
+    int ntch;       // the number of distinct traces in touched
+    int threads;    // the number of threads a counting or scoring pass uses
+} df_t;
+
+typedef struct
+{                   // the thresholds and weights pairs are classified by
+    int seqPd;      // a pair is a sequence if its pd is above this
+    int conPd;      // a pair seen both ways is concurrent if its pd is below this
+    int chcPct;     // a pair is a choice if neither action follows the other
+    count_t chcSup; //     more than chcSup + chcPct percent of nLive times
+    count_t chcW;   // the weight of a choice per live action
+    count_t conW;   // the factor the weight of a concurrency is scaled by
+    count_t seqW;   // the factor the weight of a sequence of two activities
+                    //     is scaled by
+} thresh_t;
+
+typedef struct
+{                  // the scores of all ordered pairs of live actions in a round
+    int n;         // the number of live actions, the order of every table
+    int cpct;      // the order the tables can hold
+    action_t *actns;   // the live actions, ascending
+    char *isChr;   // isChr[r] tells whether actns[r] is a letter
+    count_t *sup;  // sup[r * n + c] is sup(actns[r], actns[c])
+    count_t *supT; // supT[r * n + c] is sup(actns[c], actns[r])
+    int *pd;       // pd[r * n + c] is pd(actns[r], actns[c])
+    count_t *w;    // w[r * n + c] is w(actns[r], actns[c])
+    char *cls;     // cls[r * n + c] is PAT_CON or PAT_SEQ if the pair is one
+                   //     unless it is a choice, -1 if it is neither
+    count_t *cw;   // cw[r * n + c] is the stage 2 weight of that pattern
+    const thresh_t *th; // the thresholds cls and cw were computed by
+    int nCls[3];   // the ordered pairs in each bucket, by pattern type
+    char *dead;    // dead[r] tells whether actns[r] is already folded by the
+                   //     batch being picked, its pairs are then skipped
+    int nLive;     // the number of actions that would be live once the
+                   //     batch is folded
+    int dflt;      // the position of the pair stage 1 falls back on
+    int threads;   // the number of threads a search over the tables uses
+} score_t;
+
+typedef struct
+{                  // the rows of the pair scores handled by one worker thread
+    score_t *sc;   // the scores being computed or searched
+    df_t *df;      // the relation the scores are computed from
+    int from;      // the first row of this share
+    int to;        // one past the last row of this share
+    int best;      // the position r * n + c of the best pair found, or -1
+    count_t bestW; // the weight of the best pair found
+    int type;      // the pattern type of the best pair found
+    int nCls[3];   // the pairs of this share classified by pattern type
+} rows_t;
+
+
+typedef struct
+{                      // the statistics of a log before any pair is folded
+    int nDistEvts;     // the number of distinct events
+    action_t *distEvts; // the distinct events, ascending
+    count_t *evtFreqs; // evtFreqs[i] is the frequency of distEvts[i]
+    int nDistTrcs;     // the number of distinct traces
+    count_t nEvts;     // the total number of events
+    int nTrcs;         // the total number of traces
+    int maxFreq;       // the frequency of the most frequent trace
+    action_t *maxTrc;  // the actions of the most frequent trace
+    int maxLen;        // the number of actions in maxTrc
+} stats_t;
+
+typedef struct
+{                   // a snapshot of the DF relation over the live actions
+    int n;          // the number of live actions
+    action_t *actns; // the live actions, ascending
+    count_t *freqs; // freqs[i] is the frequency of actns[i]
+    count_t *cells; // cells[i * n + j] is sup(actns[i], actns[j])
+} dfmat_t;
+
+typedef struct
+{                   // a node of the process tree, a pattern over two actions
+    action_t code;  // the action the pattern is folded into
+    int type;       // PAT_CHC, PAT_CON or PAT_SEQ
+    action_t x;     // the left operand, an activity or the code of a node
+    action_t y;     // the right operand, an activity or the code of a node
+    count_t removed; // the number of events removed by folding the pattern
+} node_t;
+
+typedef struct
+{                  // the header of a snapshot of a log as it was read; the
+                   //     sections follow in this order, each padded to 8
+                   //     bytes: the dictionary actions, the distinct traces,
+                   //     their hashes, their events, the cases, the name text,
+                   //     the event frequencies and the DF relation in CSR form
+    char magic[4]; // SNAP_MAGIC
+    unsigned int version; // SNAP_VERSION, written in the byte order of the
+                   //     machine, so a foreign file fails the check as well
+    int ndtr;      // the number of distinct traces
+    int nevt;      // the number of events of the distinct traces
+    int ncas;      // the number of cases
+    int hasCases;  // whether the cases are stored, 0 for a streamed log
+    int nact;      // the number of actions in the dictionary
+    int nname;     // the number of activity names
+    action_t firstCode; // the first code of a folded pattern
+    int nnz;       // the number of stored cells of the DF relation
+    count_t tlen;  // the bytes of the name text
+} snapHead_t;
+
+typedef struct
+{                   // a process tree compiled for replay; an action has at
+                    //     most one parent, the pattern it was folded into
+    node_t *nodes;  // the patterns, nodes[i] has the code firstCode + i
+    int nnode;      // the number of patterns
+    action_t firstCode; // the code of the first pattern
+    names_t names;  // the names of the activities, empty if they are letters
+    arena_t arena;  // the arena the name table is taken from
+    int size;       // the number of actions the tables below cover,
+                    //     firstCode + nnode
+    char *known;    // known[a] tells whether a is an activity of the model
+                    //     or the code of one of its patterns
+    char *slot;     // slot[a] is 0 if a is the left operand of its parent,
+                    //     1 if it is the right one
+    int *coff;      // the ancestors of action a are chain[coff[a]] up to
+    int *chain;     //     chain[coff[a + 1]], as node indices, root first
+    int height;     // the most ancestors of any action
+} model_t;
+
+typedef struct
+{                  // the outcome of replaying a log on a model
+    log_t log;     // the distinct traces replayed and their cases
+    int *dev;      // dev[i] is the position of the first event distinct
+                   //     trace i deviates at, its length if it stops short
+                   //     of a pattern, -1 if it fits
+    int nfit;      // the number of distinct traces that fit
+    int nfitCas;   // the number of cases that fit
+} replay_t;
+
+typedef struct
+{                  // the distinct traces replayed by one worker thread
+    model_t *md;   // the model replayed on
+    replay_t *rp;  // the replay the traces belong to
+    const action_t *map; // map[a] is the model action of log action a
+    int from;      // the first distinct trace of this share
+    int to;        // one past the last distinct trace of this share
+} span_t;
+
+typedef struct
+{                   // the cases of a live log still taking events
+    names_t ids;    // the ids of the cases, open or recently closed
+    arena_t arena;  // the arena the id table is taken from
+    action_t **evts; // evts[i] holds the events of case i so far
+    int *len;       // len[i] is the number of events of case i, -1 once
+                    //     it is closed
+    int *cap;       // cap[i] is the number of events evts[i] can hold
+    int size;       // the number of cases the arrays can hold
+    int nopen;      // the number of open cases
+    char *scratch;  // the buffer quoted fields are unquoted into
+    size_t scap;    // the bytes scratch can hold
+} live_t;
+
+// a trace iterator stores the actions and length of the next trace and
+// returns 1, or returns 0 once there are no traces left
+typedef int (*traceIter_t)(void *ctx, action_t **actns, int *len);
+
+typedef struct
+{                  // what one set of thresholds makes of the current round
+    thresh_t th;   // the thresholds tried
+    node_t best;   // the pattern they would pick, type -1 if none
+    count_t weight; // the weight of that pattern
+    int nCls[3];   // the ordered pairs in each bucket, by pattern type
+} sweep_t;
+
+typedef struct
+{                  // a windowed DF store keeps the DF counts and event
+                   //     frequencies of buckets of cases as prefix sums, so
+                   //     any run of buckets is a difference of two rows
+    int nb;        // the number of buckets
+    int n;         // the number of dense indices counted
+    int ncell;     // the number of cells occurring in any bucket
+    int *rowPtr;   // the cells of row i are rowPtr[i] up to rowPtr[i + 1]
+    int *cols;     //     in cols, ascending within each row
+    int stride;    // the counts of one prefix row, ncell + n
+    count_t *pre;  // pre[b * stride + k] sums cell k over the buckets below
+                   //     b, or for k >= ncell the frequency of dense index
+                   //     k - ncell
+    int *cases;    // cases[b] is the number of cases in the buckets below b
+} wdf_t;
+
+typedef struct
+{                  // a miner runs discovery over one event log
+    log_t log;     // the distinct traces of the log
+    df_t df;       // the DF relation of the log, kept up to date by folds
+    score_t sc;    // the pair scores of the current round
+    action_t code; // the code the next pattern is folded into
+    int stage;     // the stage of the last pattern found, 0 before any
+    int round;     // the number of patterns found in that stage
+    int limit;     // the most patterns that stage may find
+    int nInit;     // the number of distinct events before any fold
+    int batch;     // BATCH_NONE, BATCH_FAST or BATCH_EXACT, for minerRunStage
+    thresh_t th;   // the thresholds patterns are classified by
+    int prefix;    // whether folds rewrite trie instead of the log, which
+                   //     then stays as it was read
+    trie_t trie;   // the distinct traces as a prefix tree, if prefix is set
+    FILE *metrics; // where a JSON line of timings and counts goes for every
+                   //     load phase, round and stage, NULL for none
+    double tSearch;     // the seconds the last search took
+    double searchSecs;  // the seconds spent searching in the current stage
+    double rewriteSecs; // the seconds spent folding in the current stage
+    int nRounds;   // the rounds of the current stage, a batch being one
+    int reported;  // whether the current stage has been reported
+    node_t *tree;  // the patterns folded so far, tree[i] has the code
+                   //     log.dict.firstCode + i
+    int ntree;     // the number of patterns in tree
+    int tcap;      // the number of patterns tree can hold
+} miner_t;
+
+/* Engine --------------------------------------------------------------------*/
+// the phases a miner runs on, for tools that time or drive them one by one
+int minerLoadBuffer(store_t *st, const char *buf, size_t len);
+void minerFreeStore(store_t *st);
+int minerCalcTrcsFreq(log_t *log, store_t *st);
+action_t *minerFindDistinctEvents(log_t *log, int *nDistEvts);
+count_t *minerCalcEvtFreq(log_t *log, action_t *actns, int nDistEvts, int threads);
+void minerInitDFMatrix(df_t *df, log_t *log);
+
+/* Miner API -----------------------------------------------------------------*/
+// a function that fails with -1 or NULL also does so, with errno set to
+// ENOMEM, when the memory of the miner runs out; nothing exits the process
+miner_t *minerNew(int threads);
+void minerFree(miner_t *m);
+int minerReadBuffer(miner_t *m, const char *buf, size_t len);
+int minerReadFile(miner_t *m, const char *filename);
+int minerStreamFile(miner_t *m, const char *filename);
+void minerUseTrie(miner_t *m);
+int minerReadCsvBuffer(miner_t *m, const char *buf, size_t len);
+int minerReadCsvFile(miner_t *m, const char *filename);
+const char *minerNameOf(names_t *t, action_t a);
+int minerReadIter(miner_t *m, traceIter_t next, void *ctx);
+miner_t *minerFork(miner_t *m);
+void minerInitLive(live_t *lv, miner_t *m);
+int minerLiveLine(live_t *lv, miner_t *m, const char *line, size_t len);
+void minerFreeLive(live_t *lv);
+int minerSaveSnapshot(miner_t *m, const char *filename);
+int minerLoadSnapshot(miner_t *m, const char *filename);
+int minerMergeSnapshots(miner_t *m, char **files, int n);
+int minerSaveModel(miner_t *m, const char *filename);
+int minerLoadModel(model_t *md, const char *filename);
+void minerFreeModel(model_t *md);
+int minerReplayFile(model_t *md, const char *filename, int csv, int threads,
+                    replay_t *rp);
+void minerFreeReplay(replay_t *rp);
+
+void minerDefaultThresh(thresh_t *th);
+int minerSweep(miner_t *m, int stage, const thresh_t *ths, int k, sweep_t *out);
+int minerBucketByCount(log_t *log, int perBucket, int *bucket);
+int minerBucketByTime(log_t *log, double width, int *bucket);
+void minerBuildWindows(wdf_t *w, log_t *log, const int *bucket, int nb);
+void minerFreeWindows(wdf_t *w);
+int minerWindow(miner_t *m, wdf_t *w, int from, int to, sweep_t *out);
+
+void minerStage0(miner_t *m, stats_t *st);
+void minerFreeStats(stats_t *st);
+int minerFindPattern(miner_t *m, int stage, node_t *nd);
+void minerFoldPattern(miner_t *m, node_t *nd);
+int minerFindBatch(miner_t *m, int stage, int exact, node_t *nds, int max);
+void minerFoldBatch(miner_t *m, node_t *nds, int k);
+int minerRunStage(miner_t *m, int stage);
+void minerGetDF(miner_t *m, dfmat_t *mat);
+void minerGetFreqs(miner_t *m, dfmat_t *mat);
+void minerFreeDFMat(dfmat_t *mat);
+node_t *minerTree(miner_t *m, int *n);
+size_t minerBytes(miner_t *m);
+double minerNow(void);
+
+#endif
@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+
+#define MAT_MAGIC "DFM1" // the first bytes of every binary matrix record
+
+// prepares an output to fp, or one that keeps all of its bytes in memory if
+// fp is NULL; matrices are written in the given format, a CSV output
+// starting with its header row
+void outOpen(out_t *o, FILE *fp, int fmt)
+{
+    o->fp = fp;
+    o->cap = OUT_BUFFER;
+    o->buf = malloc(o->cap);
+    o->len = 0;
+    o->fmt = fmt;
+    o->names = NULL;
+    o->dict = NULL;
+    if (fmt == MAT_CSV)
+        outStr(o, "stage,round,from,to,sup\n");
+}
+
+// writes out the bytes gathered so far
+void outFlush(out_t *o)
+{
+    if (o->len && o->fp)
+        fwrite(o->buf, 1, o->len, o->fp);
+    o->len = 0;
+}
+
+// writes out the bytes gathered so far and releases the buffer; fp is left
+// open
+void outClose(out_t *o)
+{
+    outFlush(o);
+    if (o->fp)
+        fflush(o->fp);
+    free(o->buf);
+    *o = (out_t){0};
+}
+
+// makes room for n more bytes, writing the buffer out first if needed, or
+// growing it if the output stays in memory
+void outReserve(out_t *o, size_t n)
+{
+    if (o->len + n <= o->cap)
+        return;
+    if (o->fp)
+        outFlush(o);
+    while (o->len + n > o->cap)
+        o->cap *= 2;
+    o->buf = realloc(o->buf, o->cap);
+}
+
+void outBytes(out_t *o, const void *p, size_t n)
+{
+    outReserve(o, n);
+    memcpy(o->buf + o->len, p, n);
+    o->len += n;
+}
+
+void outStr(out_t *o, const char *s)
+{
+    outBytes(o, s, strlen(s));
+}
+
+void outChar(out_t *o, char c)
+{
+    outReserve(o, 1);
+    o->buf[o->len++] = c;
+}
+
+// writes v in decimal, right aligned in a field of width characters
+void outInt(out_t *o, long long v, int width)
+{
+    char tmp[24];
+    int n = 0;
+    unsigned long long u = v < 0 ? -(unsigned long long)v : (unsigned long long)v;
+    do
+    {
+        tmp[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u);
+    if (v < 0)
+        tmp[n++] = '-';
+    outReserve(o, (size_t)(n > width ? n : width));
+    for (int i = n; i < width; i++)
+        o->buf[o->len++] = ' ';
+    while (n)
+        o->buf[o->len++] = tmp[--n];
+}
+
+// writes an action by its name, as a letter if it is an unnamed activity,
+// or as its code, right aligned in a field of width characters
+void outAction(out_t *o, action_t a, int width)
+{
+    const char *name = o->names ? minerNameOf(o->names, a) : NULL;
+    action_t firstCode = o->dict ? o->dict->firstCode : FIRST_CODE;
+    if (name)
+    {
+        size_t n = strlen(name);
+        outReserve(o, n + (width > 0 ? width : 0));
+        for (int i = (int)n; i < width; i++)
+            o->buf[o->len++] = ' ';
+        memcpy(o->buf + o->len, name, n);
+        o->len += n;
+    }
+    else if (a < firstCode)
+    {
+        outReserve(o, width > 1 ? width : 1);
+        for (int i = 1; i < width; i++)
+            o->buf[o->len++] = ' ';
+        o->buf[o->len++] = (char)a;
+    }
+    else
+        outInt(o, a, width);
+}
+
+// writes an action as a CSV field, quoting a name that needs it
+void outCsvAction(out_t *o, action_t a)
+{
+    const char *name = o->names ? minerNameOf(o->names, a) : NULL;
+    if (name == NULL || strpbrk(name, ",\"\r\n") == NULL)
+    {
+        outAction(o, a, 0);
+        return;
+    }
+    outChar(o, '"');
+    for (; *name; name++)
+    {
+        if (*name == '"')
+            outChar(o, '"');
+        outChar(o, *name);
+    }
+    outChar(o, '"');
+}
+
+// writes a run of actions as one trace line; named activities are separated
+// by commas and quoted like CSV fields where they need it
+void outActns(out_t *o, action_t *actns, int len)
+{
+    int named = o->names && o->names->n;
+    for (int i = 0; i < len; i++)
+    {
+        if (named && i)
+            outChar(o, ',');
+        if (named)
+            outCsvAction(o, actns[i]);
+        else
+            outAction(o, actns[i], 0);
+    }
+    outChar(o, '\n');
+}
+
+// writes a folded pattern as its code, type and operands on one line
+void outNode(out_t *o, node_t *nd)
+{
+    static const char *typeStr[] = {"CHC", "CON", "SEQ"};
+    outInt(o, nd->code, 0);
+    outStr(o, " = ");
+    outStr(o, typeStr[nd->type]);
+    outChar(o, '(');
+    outAction(o, nd->x, 0);
+    outChar(o, ',');
+    outAction(o, nd->y, 0);
+    outStr(o, ")\n");
+}
+
+// copies the text of the distinct trace of every case of the log, distinct
+// trace v being txt from from[v] up to from[v + 1], then releases both; a
+// streamed log, which only knows its distinct traces, has each copied once
+// per case it was observed in
+void outEach(out_t *o, log_t *log, out_t *txt, size_t *from)
+{
+    if (log->cases)
+    {
+        for (int i = 0; i < log->ncas; i++)
+        {
+            int v = log->cases[i];
+            outBytes(o, txt->buf + from[v], from[v + 1] - from[v]);
+        }
+    }
+    else
+    {
+        for (int v = 0; v < log->ndtr; v++)
+        {
+            for (int i = 0; i < log->trcs[v].freq; i++)
+                outBytes(o, txt->buf + from[v], from[v + 1] - from[v]);
+        }
+    }
+    outClose(txt);
+    free(from);
+}
+
+// writes the trace of every case; every distinct trace is formatted once and
+// copied for each of its cases
+void outCases(out_t *o, log_t *log)
+{
+    out_t txt;
+    outOpen(&txt, NULL, MAT_TEXT);
+    txt.names = o->names;
+    txt.dict = o->dict;
+    size_t *from = malloc(sizeof(size_t) * (log->ndtr + 1));
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        trace_t *tr = &log->trcs[v];
+        from[v] = txt.len;
+        outActns(&txt, log->evts + tr->head, tr->foot - tr->head + 1);
+    }
+    from[log->ndtr] = txt.len;
+    outEach(o, log, &txt, from);
+}
+
+// writes the trace of every case like outCases, taking the actions of each
+// distinct trace from the path of the prefix tree that ends at it
+void outTrieCases(out_t *o, trie_t *t, log_t *log)
+{
+    out_t txt;
+    outOpen(&txt, NULL, MAT_TEXT);
+    txt.names = o->names;
+    txt.dict = o->dict;
+    size_t *from = malloc(sizeof(size_t) * (log->ndtr + 1));
+    action_t *path = NULL;
+    int cap = 0;
+    for (int v = 0; v < log->ndtr; v++)
+    {
+        int len = 0;
+        for (int i = t->ends[v]; i > 0; i = t->parent[i])
+            len++;
+        if (len > cap)
+        {
+            cap = len;
+            path = realloc(path, sizeof(action_t) * cap);
+        }
+        int j = len;
+        for (int i = t->ends[v]; i > 0; i = t->parent[i])
+            path[--j] = t->act[i];
+        from[v] = txt.len;
+        outActns(&txt, path, len);
+    }
+    from[log->ndtr] = txt.len;
+    free(path);
+    outEach(o, log, &txt, from);
+}
+
+// writes the Directly Follows matrix of the given round: as aligned text, as
+// CSV rows of its non-zero cells, or as a binary record made of MAT_MAGIC,
+// the stage, the round and n as 32-bit integers, the n actions as 32-bit
+// integers and the n * n supports, row by row, as 64-bit integers, all in
+// the byte order of the host
+void outMatrix(out_t *o, dfmat_t *mat, int stage, int round)
+{
+    int n = mat->n;
+    if (o->fmt == MAT_BIN)
+    {
+        int head[3] = {stage, round, n};
+        outBytes(o, MAT_MAGIC, 4);
+        outBytes(o, head, sizeof(head));
+        outBytes(o, mat->actns, sizeof(action_t) * n);
+        outBytes(o, mat->cells, sizeof(count_t) * (size_t)n * n);
+        return;
+    }
+    if (o->fmt == MAT_CSV)
+    {
+        for (int row = 0; row < n; row++)
+        {
+            for (int col = 0; col < n; col++)
+            {
+                count_t cnt = mat->cells[(size_t)row * n + col];
+                if (cnt == 0)
+                    continue;
+                outInt(o, stage, 0);
+                outChar(o, ',');
+                outInt(o, round, 0);
+                outChar(o, ',');
+                outCsvAction(o, mat->actns[row]);
+                outChar(o, ',');
+                outCsvAction(o, mat->actns[col]);
+                outChar(o, ',');
+                outInt(o, cnt, 0);
+                outChar(o, '\n');
+            }
+        }
+        return;
+    }
+    outStr(o, "     ");
+    for (int i = 0; i < n; i++)
+        outAction(o, mat->actns[i], 5);
+    outChar(o, '\n');
+    for (int row = 0; row < n; row++)
+    {
+        outAction(o, mat->actns[row], 5);
+        for (int col = 0; col < n; col++)
+            outInt(o, mat->cells[(size_t)row * n + col], 5);
+        outChar(o, '\n');
+    }
+}
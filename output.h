@@ -0,0 +1,49 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdio.h>
+
+#include "miner.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define OUT_BUFFER (1 << 16) // the bytes an output gathers before writing
+#define VERB_QUIET 0   // print the discovered patterns only
+#define VERB_SUMMARY 1 // also the statistics, removed events and frequencies
+#define VERB_FULL 2    // also the DF matrices and the traces of every round
+#define MAT_TEXT 0 // matrices as aligned text
+#define MAT_CSV 1  // matrices as stage,round,from,to,sup rows of their
+                   //     non-zero cells
+#define MAT_BIN 2  // matrices as binary records, see outMatrix
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct
+{                  // an output formats into one reusable buffer and only
+                   //     writes it out once it is full
+    FILE *fp;      // where the output goes
+    char *buf;     // the bytes not written yet
+    size_t len;    // the number of bytes in buf
+    size_t cap;    // the number of bytes buf can hold
+    int fmt;       // MAT_TEXT, MAT_CSV or MAT_BIN, how matrices are written
+    names_t *names; // the names activities are printed by, NULL or empty
+                   //     to print them as letters
+    dict_t *dict;  // the dictionary whose firstCode tells activities from
+                   //     codes, NULL for FIRST_CODE
+} out_t;
+
+/* Output API ----------------------------------------------------------------*/
+void outOpen(out_t *o, FILE *fp, int fmt);
+void outFlush(out_t *o);
+void outClose(out_t *o);
+void outReserve(out_t *o, size_t n);
+void outBytes(out_t *o, const void *p, size_t n);
+void outStr(out_t *o, const char *s);
+void outChar(out_t *o, char c);
+void outInt(out_t *o, long long v, int width);
+void outAction(out_t *o, action_t a, int width);
+void outActns(out_t *o, action_t *actns, int len);
+void outNode(out_t *o, node_t *nd);
+void outCases(out_t *o, log_t *log);
+void outTrieCases(out_t *o, trie_t *t, log_t *log);
+void outMatrix(out_t *o, dfmat_t *mat, int stage, int round);
+
+#endif
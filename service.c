@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "service.h"
+
+/* Answers -------------------------------------------------------------------*/
+
+// writes all n bytes of buf to the descriptor, giving up once it is closed
+void writeAll(int fd, const char *buf, size_t n)
+{
+    while (n > 0)
+    {
+        ssize_t k = write(fd, buf, n);
+        if (k < 0 && errno == EINTR)
+            continue;
+        if (k <= 0)
+            return;
+        buf += k;
+        n -= k;
+    }
+}
+
+// sends the answer formatted so far to the descriptor
+void answer(service_t *sv, int fd)
+{
+    writeAll(fd, sv->out.buf, sv->out.len);
+    sv->out.len = 0;
+}
+
+// runs both stages over a copy of the maintained state and formats the
+// patterns found after a line with their number and the milliseconds taken;
+// the state itself is left as it is
+void queryTree(service_t *sv)
+{
+    out_t *o = &sv->out;
+    double t = minerNow();
+    miner_t *f = minerFork(sv->m);
+    if (f == NULL)
+    {
+        outStr(o, "error cannot copy the log\n");
+        return;
+    }
+    minerRunStage(f, 1);
+    minerRunStage(f, 2);
+    int n;
+    node_t *tree = minerTree(f, &n);
+    char head[64];
+    snprintf(head, sizeof(head), "tree %d %.3f\n", n, 1e3 * (minerNow() - t));
+    outStr(o, head);
+    o->names = &f->log.names;
+    o->dict = &f->log.dict;
+    for (int i = 0; i < n; i++)
+        outNode(o, &tree[i]);
+    o->names = &sv->m->log.names;
+    o->dict = &sv->m->log.dict;
+    minerFree(f);
+}
+
+// formats the counts of the maintained state
+void queryStats(service_t *sv)
+{
+    out_t *o = &sv->out;
+    log_t *log = &sv->m->log;
+    outStr(o, "cases ");
+    outInt(o, log->ncas, 0);
+    outStr(o, " traces ");
+    outInt(o, log->ndtr, 0);
+    outStr(o, " events ");
+    outInt(o, log->nevt, 0);
+    outStr(o, " open ");
+    outInt(o, sv->live.nopen, 0);
+    outStr(o, " actions ");
+    outInt(o, log->dict.nact, 0);
+    outChar(o, '\n');
+}
+
+/* Connections ---------------------------------------------------------------*/
+
+// checks whether the len bytes of line are the given command
+int isCmd(const char *line, size_t len, const char *cmd)
+{
+    return len == strlen(cmd) && memcmp(line, cmd, len) == 0;
+}
+
+// takes one line from a connection: a command if it starts with '!', a
+// case,activity event otherwise
+void serveLine(service_t *sv, conn_t *c, const char *line, size_t len)
+{
+    if (len > 0 && line[len - 1] == '\r')
+        len--;
+    if (len == 0)
+        return;
+    if (line[0] != '!')
+    {
+        if (minerLiveLine(&sv->live, sv->m, line, len) < 0)
+        {
+            outStr(&sv->out, "error the log is full\n");
+            answer(sv, c->out);
+        }
+        return;
+    }
+    if (isCmd(line, len, "!tree"))
+        queryTree(sv);
+    else if (isCmd(line, len, "!stats"))
+        queryStats(sv);
+    else if (isCmd(line, len, "!quit"))
+    {
+        sv->quit = 1;
+        outStr(&sv->out, "bye\n");
+    }
+    else
+        outStr(&sv->out, "error unknown command\n");
+    answer(sv, c->out);
+}
+
+// reads what the connection has and serves every line it completes; returns
+// 0 once the connection is closed, serving its last line first
+int readConn(service_t *sv, conn_t *c)
+{
+    if (c->cap - c->len < READ_CHUNK)
+    {
+        c->cap = c->len + READ_CHUNK;
+        c->buf = realloc(c->buf, c->cap);
+    }
+    ssize_t n = read(c->in, c->buf + c->len, READ_CHUNK);
+    if (n < 0 && errno == EINTR)
+        return 1;
+    if (n <= 0)
+    {
+        if (c->len)
+            serveLine(sv, c, c->buf, c->len);
+        c->len = 0;
+        return 0;
+    }
+    size_t from = 0;
+    for (size_t i = c->len; i < c->len + n; i++)
+    {
+        if (c->buf[i] == '\n')
+        {
+            serveLine(sv, c, c->buf + from, i - from);
+            from = i + 1;
+        }
+    }
+    c->len += n;
+    memmove(c->buf, c->buf + from, c->len - from);
+    c->len -= from;
+    return 1;
+}
+
+// listens on a unix socket at the given path, replacing a stale one; returns
+// the listening descriptor, or -1 if it cannot be opened
+int openSocket(const char *path)
+{
+    struct sockaddr_un addr = {0};
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, MAX_CLIENTS) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Service API ---------------------------------------------------------------*/
+
+// serves case,activity events and queries from stdin, or from the clients of
+// a unix socket at sockPath if it is not NULL, folding every completed case
+// into the empty miner m; a line with a case but no activity completes it,
+// and !tree, !stats and !quit are answered to the connection they came on.
+// With an interval, the patterns are found again every interval seconds and
+// written to stdout, as they are once more when the service stops. Serving
+// stdin stops at its end. Returns 0, or -1 if the socket cannot be opened
+int runService(miner_t *m, const char *sockPath, int interval)
+{
+    service_t sv = {0};
+    sv.m = m;
+    sv.interval = interval;
+    conn_t conns[MAX_CLIENTS];
+    int nconn = 0;
+    int lfd = -1;
+    if (sockPath)
+    {
+        lfd = openSocket(sockPath);
+        if (lfd < 0)
+            return -1;
+    }
+    else
+        conns[nconn++] = (conn_t){STDIN_FILENO, STDOUT_FILENO, NULL, 0, 0};
+    signal(SIGPIPE, SIG_IGN);
+    minerInitLive(&sv.live, m);
+    outOpen(&sv.out, NULL, MAT_TEXT);
+    sv.out.names = &m->log.names;
+    sv.out.dict = &m->log.dict;
+
+    double next = minerNow() + interval;
+    while (!sv.quit && (lfd >= 0 || nconn > 0))
+    {
+        struct pollfd fds[MAX_CLIENTS + 1];
+        for (int i = 0; i < nconn; i++)
+            fds[i] = (struct pollfd){conns[i].in, POLLIN, 0};
+        int nfd = nconn;
+        if (lfd >= 0)
+            fds[nfd++] = (struct pollfd){lfd, POLLIN, 0};
+        int timeout = -1;
+        if (interval > 0)
+        {
+            double left = next - minerNow();
+            timeout = left > 0 ? (int)(left * 1e3) + 1 : 0;
+        }
+        if (poll(fds, nfd, timeout) < 0 && errno != EINTR)
+            break;
+
+        if (interval > 0 && minerNow() >= next)
+        {
+            queryTree(&sv);
+            answer(&sv, STDOUT_FILENO);
+            next = minerNow() + interval;
+        }
+        int n = nconn;
+        for (int i = 0; i < n && !sv.quit; i++)
+        {
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !readConn(&sv, &conns[i]))
+            {
+                if (conns[i].in != STDIN_FILENO)
+                    close(conns[i].in);
+                conns[i].in = -1;
+            }
+        }
+        if (lfd >= 0 && (fds[n].revents & POLLIN))
+        {
+            int fd = accept(lfd, NULL, NULL);
+            if (fd >= 0 && nconn < MAX_CLIENTS)
+                conns[nconn++] = (conn_t){fd, fd, NULL, 0, 0};
+            else if (fd >= 0)
+                close(fd);
+        }
+        int k = 0;
+        for (int i = 0; i < nconn; i++)
+        {
+            if (conns[i].in >= 0)
+                conns[k++] = conns[i];
+            else
+                free(conns[i].buf);
+        }
+        nconn = k;
+    }
+
+    queryTree(&sv);
+    answer(&sv, STDOUT_FILENO);
+    for (int i = 0; i < nconn; i++)
+    {
+        if (conns[i].in != STDIN_FILENO)
+            close(conns[i].in);
+        free(conns[i].buf);
+    }
+    if (lfd >= 0)
+    {
+        close(lfd);
+        unlink(sockPath);
+    }
+    outClose(&sv.out);
+    minerFreeLive(&sv.live);
+    return 0;
+}
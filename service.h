@@ -0,0 +1,36 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <stddef.h>
+
+#include "miner.h"
+#include "output.h"
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define MAX_CLIENTS 64       // the connections a socket service serves at once
+#define READ_CHUNK (1 << 16) // the bytes read from a connection at a time
+
+/* TYPE DEFINITIONS ----------------------------------------------------------*/
+typedef struct
+{                  // a connection lines of events and queries come in over
+    int in;        // the descriptor read from, -1 once it is closed
+    int out;       // the descriptor answers are written to
+    char *buf;     // the bytes of the line not complete yet
+    size_t len;    // the number of bytes in buf
+    size_t cap;    // the number of bytes buf can hold
+} conn_t;
+
+typedef struct
+{                  // a service keeps a live log up to date and answers
+                   //     queries from its maintained state
+    miner_t *m;    // the miner the completed cases are folded into
+    live_t live;   // the cases still open
+    out_t out;     // the answer being formatted, kept in memory
+    int interval;  // the seconds between two timed discoveries, 0 for none
+    int quit;      // whether a client asked the service to stop
+} service_t;
+
+/* Service API ---------------------------------------------------------------*/
+int runService(miner_t *m, const char *sockPath, int interval);
+
+#endif
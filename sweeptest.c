@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "miner.h"
+
+// Checks minerSweep on synthetic logs: in every round of both stages, the
+// set of thresholds of the miner picks the pattern minerFindPattern folds
+// next, and the sweep leaves the pairs classified by the miner's own
+// thresholds.
+// Exits with 0 if every round agrees.
+// Build: make check, which builds and runs it as build/sweeptest
+
+/* #DEFINE'S -----------------------------------------------------------------*/
+#define DEFAULT_SEEDS 20
+#define SWEEP_CASES 300
+#define SWEEP_VARIANTS 30
+#define SWEEP_LENGTH 10
+
+// the sets of thresholds swept besides those of the miner
+static const thresh_t sweepSets[] = {
+    {50, 30, 1, 0, 100, 100, 100},
+    {90, 10, 5, 0, 100, 100, 100},
+    {60, 40, 20, 2, 10, 1, 1000},
+};
+
+/* Generator -----------------------------------------------------------------*/
+
+// returns the next number of a splitmix64 sequence, so a seed always gives
+// the same log
+unsigned long long nextRand(unsigned long long *state)
+{
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// generates a log of SWEEP_CASES letter traces drawn from a few variants
+// that mostly walk the alphabet in order, and stores its size in len
+char *genLog(unsigned long long seed, size_t *len)
+{
+    unsigned long long state = seed;
+    int nact = 4 + (int)(nextRand(&state) % 16);
+    char vars[SWEEP_VARIANTS][2 * SWEEP_LENGTH];
+    int varLen[SWEEP_VARIANTS];
+    for (int v = 0; v < SWEEP_VARIANTS; v++)
+    {
+        varLen[v] = SWEEP_LENGTH / 2 + (int)(nextRand(&state) % (SWEEP_LENGTH + 1));
+        for (int i = 0; i < varLen[v]; i++)
+        {
+            int j = i * nact / varLen[v] + (int)(nextRand(&state) % 3) - 1;
+            vars[v][i] = 'a' + (j < 0 ? 0 : j >= nact ? nact - 1 : j);
+        }
+    }
+    char *buf = malloc((size_t)SWEEP_CASES * (2 * SWEEP_LENGTH + 1));
+    size_t pos = 0;
+    for (int i = 0; i < SWEEP_CASES; i++)
+    {
+        int r = (int)(nextRand(&state) % SWEEP_VARIANTS);
+        int v = (int)(nextRand(&state) % (r + 1));
+        memcpy(buf + pos, vars[v], varLen[v]);
+        pos += varLen[v];
+        buf[pos++] = '\n';
+    }
+    *len = pos;
+    return buf;
+}
+
+/* Check ---------------------------------------------------------------------*/
+
+// sweeps every round of a stage before folding its pattern; returns the
+// number of rounds that disagree
+int checkStage(miner_t *m, int stage, unsigned long long seed)
+{
+    int nset = sizeof(sweepSets) / sizeof(sweepSets[0]) + 1;
+    thresh_t *ths = malloc(sizeof(thresh_t) * nset);
+    sweep_t *sw = malloc(sizeof(sweep_t) * nset);
+    memcpy(ths + 1, sweepSets, sizeof(sweepSets));
+    int fails = 0;
+    node_t nd;
+    for (int round = 1;; round++)
+    {
+        // the miner's own set goes first, so the later sets leave their
+        // classification behind if the sweep does not restore it
+        ths[0] = m->th;
+        minerSweep(m, stage, ths, nset, sw);
+        score_t *sc = &m->sc;
+        size_t cells = (size_t)sc->n * sc->n;
+        char *cls = malloc(cells ? cells : 1);
+        count_t *cw = malloc(sizeof(count_t) * (cells ? cells : 1));
+        int nCls[3];
+        memcpy(cls, sc->cls, cells);
+        memcpy(cw, sc->cw, sizeof(count_t) * cells);
+        memcpy(nCls, sc->nCls, sizeof(nCls));
+        // a sweep of no sets only scores and classifies by the miner's own
+        minerSweep(m, stage, NULL, 0, NULL);
+        int same = sc->th == &m->th && memcmp(nCls, sc->nCls, sizeof(nCls)) == 0 &&
+                   memcmp(cls, sc->cls, cells) == 0 &&
+                   memcmp(cw, sc->cw, sizeof(count_t) * cells) == 0;
+        free(cls);
+        free(cw);
+        if (!same)
+            printf("FAIL seed %llu stage %d round %d: the pairs are not classified "
+                   "by the miner's thresholds\n", seed, stage, round);
+
+        if (!minerFindPattern(m, stage, &nd))
+        {
+            fails += !same;
+            break;
+        }
+        int picked = sw[0].best.type == nd.type && sw[0].best.x == nd.x &&
+                     sw[0].best.y == nd.y;
+        if (!picked)
+            printf("FAIL seed %llu stage %d round %d: the sweep picks another "
+                   "pattern than minerFindPattern\n", seed, stage, round);
+        fails += !same || !picked;
+        minerFoldPattern(m, &nd);
+    }
+    free(ths);
+    free(sw);
+    return fails;
+}
+
+int main(int argc, char *argv[])
+{
+    int seeds = argc > 1 ? atoi(argv[1]) : DEFAULT_SEEDS;
+    if (argc > 2 || seeds < 1)
+    {
+        fprintf(stderr, "usage: %s [seeds]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    int fails = 0;
+    for (int s = 1; s <= seeds; s++)
+    {
+        size_t len;
+        char *buf = genLog((unsigned long long)s, &len);
+        miner_t *m = minerNew(DEFAULT_THREADS);
+        minerReadBuffer(m, buf, len);
+        fails += checkStage(m, 1, (unsigned long long)s);
+        fails += checkStage(m, 2, (unsigned long long)s);
+        minerFree(m);
+        free(buf);
+    }
+    printf("%d rounds disagree over %d logs\n", fails, seeds);
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}